@@ -0,0 +1,299 @@
+#ifndef FLOW_STATS_H
+#define FLOW_STATS_H
+
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/callback.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/seq-ts-size-header.h"
+#include "ns3/simulator.h"
+
+#include "log-histogram.h"
+#include "throughput-sampler.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Packet and byte counts of sender and sink applications, per flow and per node.
+ *
+ * A flow is one sender application and the sink it sends to. Each
+ * trace is bound to the collector and an index instead of a string, so a
+ * packet costs a few 64-bit additions and, on receipt, one hash lookup
+ * of the sender's address to find its flow. Only packets with a payload
+ * are counted, as data packets.
+ *
+ * When the senders stamp their packets with a SeqTsSizeHeader, each
+ * packet a sink reassembles also gives a one-way delay, from the stamp to
+ * its arrival, and a jitter, the change from the flow's previous delay.
+ * Both go into per-flow LogHistograms of nanoseconds, whose memory does
+ * not grow with the run.
+ */
+class FlowStatsCollector
+{
+  public:
+    /// Counters of one flow, one node or the whole run.
+    struct Counters
+    {
+        uint64_t txPackets = 0;
+        uint64_t txBytes = 0;
+        uint64_t rxPackets = 0;
+        uint64_t rxBytes = 0;
+    };
+
+    /**
+     * \brief Count what \p sink receives.
+     * \return the sink index to pass to AddFlow.
+     */
+    uint32_t AddSink(Ptr<Application> sink)
+    {
+        uint32_t index = m_sinkNodes.size();
+        m_sinkNodes.push_back(NodeSlot(sink->GetNode()->GetId()));
+        sink->TraceConnectWithoutContext("Rx", MakeBoundCallback(&FlowStatsCollector::RxTrace, this, index));
+        sink->TraceConnectWithoutContext("RxWithSeqTsSize",
+                                         MakeBoundCallback(&FlowStatsCollector::DelayTrace, this, index));
+        return index;
+    }
+
+    /**
+     * \brief Count what \p sender sends to the sink \p sinkIndex.
+     * \param source the sender's address, as the sink sees it.
+     * \return the flow index.
+     */
+    uint32_t AddFlow(Ptr<Application> sender, Ipv4Address source, uint32_t sinkIndex)
+    {
+        uint32_t flow = m_flows.size();
+        m_flows.push_back(Counters());
+        m_latency.push_back(Latency());
+        m_flowNodes.push_back(NodeSlot(sender->GetNode()->GetId()));
+        m_flowSinks.push_back(sinkIndex);
+        m_byRoute[Route(source, sinkIndex)] = flow;
+        sender->TraceConnectWithoutContext("Tx", MakeBoundCallback(&FlowStatsCollector::TxTrace, this, flow));
+        return flow;
+    }
+
+    /// Also bin every received byte in \p sampler, which must outlive the run.
+    void AttachSampler(ThroughputSampler* sampler)
+    {
+        m_sampler = sampler;
+    }
+
+    size_t Flows() const
+    {
+        return m_flows.size();
+    }
+
+    const Counters& Flow(uint32_t flow) const
+    {
+        return m_flows[flow];
+    }
+
+    /// Counters of node \p id: what its senders sent and its sinks received.
+    Counters Node(uint32_t id) const
+    {
+        return id < m_nodes.size() ? m_nodes[id] : Counters();
+    }
+
+    /// One-way delays of \p flow in nanoseconds.
+    const LogHistogram& Delay(uint32_t flow) const
+    {
+        return m_latency[flow].delay;
+    }
+
+    /// Jitter of \p flow in nanoseconds.
+    const LogHistogram& Jitter(uint32_t flow) const
+    {
+        return m_latency[flow].jitter;
+    }
+
+    const Counters& Total() const
+    {
+        return m_total;
+    }
+
+    /// Received kbit/s of \p flow over \p seconds.
+    double Throughput(uint32_t flow, double seconds) const
+    {
+        return m_flows[flow].rxBytes * 8.0 / seconds / 1000;
+    }
+
+    /// Received over sent data packets of \p flow; 0 if it sent none.
+    double DeliveryRatio(uint32_t flow) const
+    {
+        const Counters& c = m_flows[flow];
+        return c.txPackets ? (double)c.rxPackets / c.txPackets : 0;
+    }
+
+    /// Jain's fairness index of the flows' throughputs; 1 when every flow gets the same.
+    double JainIndex() const
+    {
+        double sum = 0;
+        double squares = 0;
+        for (const Counters& c : m_flows)
+        {
+            sum += c.rxBytes;
+            squares += (double)c.rxBytes * c.rxBytes;
+        }
+        return squares > 0 ? sum * sum / (m_flows.size() * squares) : 0;
+    }
+
+    /// One line per flow: index, sender and sink node, counters, kbit/s over \p seconds and delivery ratio.
+    void Print(std::ostream& os, double seconds) const
+    {
+        os << "Flow\tSrc\tSink\tTxPkts\tTxBytes\tRxPkts\tRxBytes\tkbit/s\tPDR\tdelay ms p50/p99/p99.9" << std::endl;
+        for (uint32_t f = 0; f < m_flows.size(); f++)
+        {
+            const Counters& c = m_flows[f];
+            os << f << "\t" << m_flowNodes[f] << "\t" << m_sinkNodes[m_flowSinks[f]] << "\t" << c.txPackets << "\t"
+               << c.txBytes << "\t" << c.rxPackets << "\t" << c.rxBytes << "\t" << std::fixed << std::setprecision(2)
+               << Throughput(f, seconds) << "\t" << std::setprecision(4) << DeliveryRatio(f) << std::defaultfloat;
+            const LogHistogram& d = m_latency[f].delay;
+            os << "\t" << Ms(d.Quantile(0.5)) << "/" << Ms(d.Quantile(0.99)) << "/" << Ms(d.Quantile(0.999)) << std::endl;
+        }
+        os << "Jain's fairness index: " << JainIndex() << std::endl;
+    }
+
+    /// Delay and jitter p50, p99 and p99.9 of all flows together in ms, as six tab-separated columns.
+    void PrintLatencyColumns(std::ostream& os) const
+    {
+        LogHistogram delay;
+        LogHistogram jitter;
+        for (const Latency& l : m_latency)
+        {
+            delay.Merge(l.delay);
+            jitter.Merge(l.jitter);
+        }
+        for (const LogHistogram* h : {&delay, &jitter})
+        {
+            for (double q : {0.5, 0.99, 0.999})
+            {
+                os << "\t" << Ms(h->Quantile(q));
+            }
+        }
+    }
+
+  private:
+    static constexpr uint32_t kNoFlow = UINT32_MAX;
+
+    /// Delay histograms of one flow.
+    struct Latency
+    {
+        LogHistogram delay;
+        LogHistogram jitter;
+        int64_t last = -1; //!< Previous delay in ns, -1 before the first.
+    };
+
+    static double Ms(uint64_t ns)
+    {
+        return ns / 1e6;
+    }
+
+    static uint64_t Route(Ipv4Address source, uint32_t sinkIndex)
+    {
+        return (uint64_t)source.Get() << 32 | sinkIndex;
+    }
+
+    /// Make room for the counters of node \p id.
+    uint32_t NodeSlot(uint32_t id)
+    {
+        if (id >= m_nodes.size())
+        {
+            m_nodes.resize(id + 1);
+        }
+        return id;
+    }
+
+    /// Flow of a packet from \p from received by sink \p sink, or kNoFlow.
+    uint32_t FindFlow(const Address& from, uint32_t sink) const
+    {
+        if (!InetSocketAddress::IsMatchingType(from))
+        {
+            return kNoFlow;
+        }
+        auto it = m_byRoute.find(Route(InetSocketAddress::ConvertFrom(from).GetIpv4(), sink));
+        return it == m_byRoute.end() ? kNoFlow : it->second;
+    }
+
+    static void TxTrace(FlowStatsCollector* stats, uint32_t flow, Ptr<const Packet> packet)
+    {
+        uint32_t size = packet->GetSize();
+        if (size == 0)
+        {
+            return;
+        }
+        for (Counters* c : {&stats->m_flows[flow], &stats->m_nodes[stats->m_flowNodes[flow]], &stats->m_total})
+        {
+            c->txPackets++;
+            c->txBytes += size;
+        }
+    }
+
+    static void RxTrace(FlowStatsCollector* stats, uint32_t sink, Ptr<const Packet> packet, const Address& from)
+    {
+        uint32_t size = packet->GetSize();
+        if (size == 0)
+        {
+            return;
+        }
+        uint32_t f = stats->FindFlow(from, sink);
+        Counters* flow = f == kNoFlow ? nullptr : &stats->m_flows[f];
+        for (Counters* c : {flow, &stats->m_nodes[stats->m_sinkNodes[sink]], &stats->m_total})
+        {
+            if (c)
+            {
+                c->rxPackets++;
+                c->rxBytes += size;
+            }
+        }
+        if (stats->m_sampler)
+        {
+            stats->m_sampler->Add(size);
+        }
+    }
+
+    static void DelayTrace(FlowStatsCollector* stats,
+                           uint32_t sink,
+                           Ptr<const Packet> packet,
+                           const Address& from,
+                           const Address& to,
+                           const SeqTsSizeHeader& header)
+    {
+        uint32_t f = stats->FindFlow(from, sink);
+        int64_t delay = (Simulator::Now() - header.GetTs()).GetNanoSeconds();
+        if (f == kNoFlow || delay < 0)
+        {
+            return;
+        }
+        Latency& l = stats->m_latency[f];
+        l.delay.Add(delay);
+        if (l.last >= 0)
+        {
+            l.jitter.Add(std::llabs(delay - l.last));
+        }
+        l.last = delay;
+    }
+
+    std::vector<Counters> m_flows;     //!< By flow index.
+    std::vector<Latency> m_latency;    //!< By flow index.
+    std::vector<uint32_t> m_flowNodes; //!< Sender node of each flow.
+    std::vector<uint32_t> m_flowSinks; //!< Sink index of each flow.
+    std::vector<uint32_t> m_sinkNodes; //!< Node of each sink.
+    std::vector<Counters> m_nodes;     //!< By node id.
+    Counters m_total;                  //!< All flows.
+    std::unordered_map<uint64_t, uint32_t> m_byRoute; //!< (source address, sink index) to flow.
+    ThroughputSampler* m_sampler = nullptr;           //!< Bins received bytes over time, if set.
+};
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_H */
@@ -0,0 +1,112 @@
+#ifndef LOG_HISTOGRAM_H
+#define LOG_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace ns3
+{
+
+/**
+ * \brief Counts of non-negative integers in log-spaced buckets of bounded relative width, HDR style.
+ *
+ * Values below 2^kSubBits have a bucket each. Above, every power of two
+ * is split into 2^kSubBits equal buckets, picked by the bits just below
+ * the leading one, so a bucket is at most 1/32 of its values wide. That
+ * covers the whole 64-bit range in a fixed array: memory does not depend
+ * on the number of samples or on their range, and recording is a count
+ * of leading zeros, two shifts and an increment.
+ */
+class LogHistogram
+{
+  public:
+    static constexpr unsigned kSubBits = 5;
+    static constexpr unsigned kSubBuckets = 1u << kSubBits;
+    static constexpr unsigned kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    LogHistogram()
+        : m_counts(),
+          m_count(0)
+    {
+    }
+
+    void Add(uint64_t value)
+    {
+        m_counts[Bucket(value)]++;
+        m_count++;
+    }
+
+    /// Add every count of \p other.
+    void Merge(const LogHistogram& other)
+    {
+        for (unsigned b = 0; b < kBuckets; b++)
+        {
+            m_counts[b] += other.m_counts[b];
+        }
+        m_count += other.m_count;
+    }
+
+    uint64_t Count() const
+    {
+        return m_count;
+    }
+
+    /**
+     * \brief The value at quantile \p q in [0, 1], as the upper end of its bucket.
+     *
+     * The upper end makes tail quantiles err on the high side, by at
+     * most a bucket width. 0 if the histogram is empty.
+     */
+    uint64_t Quantile(double q) const
+    {
+        if (m_count == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(q * m_count));
+        uint64_t seen = 0;
+        for (unsigned b = 0; b < kBuckets; b++)
+        {
+            seen += m_counts[b];
+            if (seen >= rank)
+            {
+                return UpperEnd(b);
+            }
+        }
+        return UpperEnd(kBuckets - 1);
+    }
+
+  private:
+    static unsigned Bucket(uint64_t value)
+    {
+        if (value < kSubBuckets)
+        {
+            return (unsigned)value;
+        }
+        unsigned exponent = 63 - __builtin_clzll(value); // >= kSubBits
+        unsigned sub = (unsigned)(value >> (exponent - kSubBits)) & (kSubBuckets - 1);
+        return (exponent - kSubBits + 1) * kSubBuckets + sub;
+    }
+
+    /// Largest value that falls into bucket \p b.
+    static uint64_t UpperEnd(unsigned b)
+    {
+        if (b < kSubBuckets)
+        {
+            return b;
+        }
+        unsigned exponent = b / kSubBuckets + kSubBits - 1;
+        uint64_t sub = b % kSubBuckets;
+        uint64_t low = (kSubBuckets + sub) << (exponent - kSubBits);
+        return low + ((uint64_t(1) << (exponent - kSubBits)) - 1);
+    }
+
+    std::array<uint64_t, kBuckets> m_counts; //!< Samples per bucket.
+    uint64_t m_count;                        //!< Samples in all.
+};
+
+} // namespace ns3
+
+#endif /* LOG_HISTOGRAM_H */
@@ -10,36 +10,14 @@
 #include "ns3/flow-monitor.h"
 #include "ns3/flow-monitor-helper.h"
 
+#include "flow-stats.h"
+
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("Mobile Network");
-void addApplication(std::string dataRate, int packetSize, int nFlows, ApplicationContainer* sinkApps, ApplicationContainer* senderApps, Ipv4InterfaceContainer receiverInterfaces, Ipv4InterfaceContainer senderInterfaces, NodeContainer receiverWifiStaNodes, NodeContainer senderWifiStaNodes, uint32_t nWifiStatNodes);
+void addApplication(std::string dataRate, int packetSize, int nFlows, ApplicationContainer* sinkApps, ApplicationContainer* senderApps, Ipv4InterfaceContainer receiverInterfaces, Ipv4InterfaceContainer senderInterfaces, NodeContainer receiverWifiStaNodes, NodeContainer senderWifiStaNodes, uint32_t nWifiStatNodes, FlowStatsCollector* stats);
 Ptr<OutputStreamWrapper> stream;
-int totalBytesSent = 0;
-int totalBytesReceived = 0;
-int nPacketsSent = 0;
-int nPacketsReceived = 0;
-
-// rx callback
-static void
-RxCallback(std::string fileName, Ptr<const Packet> packet, const Address &address)
-{
-    totalBytesReceived += packet->GetSize();
-    // ignore everything but data packets
-    if (packet->GetSize() > 0)
-        nPacketsReceived++;
-}
-
-// tx callback
-static void
-TxCallback(std::string fileName, Ptr<const Packet> packet)
-{
-    totalBytesSent += packet->GetSize();
-    // ignore everything but data packets
-    if (packet->GetSize() > 0)
-        nPacketsSent++;
-}
 
 int
 main(int argc, char* argv[])
@@ -49,6 +27,8 @@ main(int argc, char* argv[])
     uint32_t nPackets = 100;
     uint32_t velocity = 5; // for mobile
     std::string fileName = "tpvsflow";
+    double warmup = 3.0; // seconds; the steady state starts here
+    double binWidth = 0.1; // seconds
     
     
     CommandLine cmd(__FILE__);
@@ -57,6 +37,8 @@ main(int argc, char* argv[])
     cmd.AddValue("nPackets", "Number of packets per second", nPackets);
     cmd.AddValue("speed", "Speed of nodes", velocity);
     cmd.AddValue("fileName", "Output file name", fileName);
+    cmd.AddValue("warmup", "Start of the steady state in seconds; earlier bytes are left out of the throughput", warmup);
+    cmd.AddValue("binWidth", "Width of a throughput bin in seconds", binWidth);
 
     cmd.Parse(argc, argv);
 
@@ -181,12 +163,19 @@ main(int argc, char* argv[])
 
     ApplicationContainer sinkApps;
     ApplicationContainer senderApps;
-    addApplication(dataRate, packetSize, nFlows, &sinkApps, &senderApps, receiverInterfaces, senderInterfaces, receiverWifiStaNodes, senderWifiStaNodes, nWifiStatNodes);
+    FlowStatsCollector stats;
+    addApplication(dataRate, packetSize, nFlows, &sinkApps, &senderApps, receiverInterfaces, senderInterfaces, receiverWifiStaNodes, senderWifiStaNodes, nWifiStatNodes, &stats);
 
+    double senderStart = 2.0;
+    double senderStop = 9.0;
     sinkApps.Start(Seconds(1.0));
-    senderApps.Start(Seconds(2.0));
+    senderApps.Start(Seconds(senderStart));
     sinkApps.Stop(Seconds(10.0));
-    senderApps.Stop(Seconds(9.0));
+    senderApps.Stop(Seconds(senderStop));
+
+    // throughput bins from 0 until the senders stop; the steady state is [warmup, senderStop)
+    ThroughputSampler sampler(Seconds(binWidth), (uint32_t)std::ceil(senderStop / binWidth), Seconds(warmup), Seconds(senderStop));
+    stats.AttachSampler(&sampler);
     
 
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
@@ -196,25 +185,24 @@ main(int argc, char* argv[])
     AsciiTraceHelper asciiTraceHelper;
     stream  = asciiTraceHelper.CreateFileStream("scratch/statsM/" + fileName);
 
-    // install trace here for calculating throughput
-    for(uint32_t i = 0; i < nWifiStatNodes; i++){
-        sinkApps.Get(i)->TraceConnectWithoutContext("Rx", MakeBoundCallback(&RxCallback, "scratch/statsM/throughput.txt"));
-    }
-
-	for(uint32_t i = 0; i < nFlows; i++){
-        senderApps.Get(i)->TraceConnectWithoutContext("Tx", MakeBoundCallback(&TxCallback, "scratch/statsM/throughput.txt"));
-    }
-
     Simulator::Run();
     Simulator::Destroy();
 
+    const FlowStatsCollector::Counters& total = stats.Total();
+    // columns: nodes, flows, speed, packets/s, steady-state throughput, delivery ratio, Jain's index over the flows,
+    // then delay p50, p99, p99.9 and jitter p50, p99, p99.9 in ms over all flows
     *stream->GetStream() << nNodes << "\t" << nFlows << "\t" << velocity << "\t" << nPackets << "\t" << 
-    (double)totalBytesReceived * 8 / 9  / 1000 << "\t" << (double)nPacketsReceived / nPacketsSent << std::endl;
+    sampler.SteadyThroughput() << "\t" << (double)total.rxPackets / total.txPackets << "\t" << stats.JainIndex();
+    stats.PrintLatencyColumns(*stream->GetStream());
+    *stream->GetStream() << std::endl;
   
+    stats.Print(std::cout, senderStop - senderStart);
+    Ptr<OutputStreamWrapper> binStream = asciiTraceHelper.CreateFileStream("scratch/statsM/" + fileName + ".bins");
+    sampler.Print(*binStream->GetStream());
     return 0;
 }
 
-void addApplication(std::string dataRate, int packetSize, int nFlows, ApplicationContainer* sinkApps, ApplicationContainer* senderApps, Ipv4InterfaceContainer receiverInterfaces, Ipv4InterfaceContainer senderInterfaces, NodeContainer receiverWifiStaNodes, NodeContainer senderWifiStaNodes, uint32_t nWifiStatNodes){
+void addApplication(std::string dataRate, int packetSize, int nFlows, ApplicationContainer* sinkApps, ApplicationContainer* senderApps, Ipv4InterfaceContainer receiverInterfaces, Ipv4InterfaceContainer senderInterfaces, NodeContainer receiverWifiStaNodes, NodeContainer senderWifiStaNodes, uint32_t nWifiStatNodes, FlowStatsCollector* stats){
     // changing segment size to packetSize
     Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(packetSize));
     
@@ -222,8 +210,11 @@ void addApplication(std::string dataRate, int packetSize, int nFlows, Applicatio
     for(uint32_t i = 0; i < nWifiStatNodes; i++){
         PacketSinkHelper sinkHelper("ns3::TcpSocketFactory",
                                     InetSocketAddress(Ipv4Address::GetAny(), 9));
+        // the senders stamp every packet, so the sinks can measure one-way delay
+        sinkHelper.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(true));
         ApplicationContainer sinkApp = sinkHelper.Install(receiverWifiStaNodes.Get(i));
         sinkApps->Add(sinkApp);
+        stats->AddSink(sinkApp.Get(0));
     }
 
     /* Install TCP/UDP Transmitter on the station */
@@ -232,6 +223,7 @@ void addApplication(std::string dataRate, int packetSize, int nFlows, Applicatio
     sender_helper.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
     sender_helper.SetAttribute("PacketSize", UintegerValue(packetSize));    
     sender_helper.SetAttribute("DataRate", DataRateValue(DataRate(dataRate)));
+    sender_helper.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(true));
     int cnt = 0;
     for(uint32_t i = 0; i < nWifiStatNodes; i++){
         for(uint32_t j = 0; j < nWifiStatNodes; j++){
@@ -239,6 +231,7 @@ void addApplication(std::string dataRate, int packetSize, int nFlows, Applicatio
            
             ApplicationContainer senderApp = sender_helper.Install(senderWifiStaNodes.Get(j));
             senderApps->Add(senderApp);
+            stats->AddFlow(senderApp.Get(0), senderInterfaces.GetAddress(j), i);
             if(++cnt >= nFlows) break;
         }
         if(cnt >= nFlows) break;
@@ -1,69 +1,90 @@
 
+source "$(dirname "$0")/sweep.sh"
+
 rm -rf scratch/stats
 mkdir -p scratch/stats
 
 rm -rf scratch/plots
 mkdir -p scratch/plots
 
+# build once; the runs below skip the build so that they can share the machine
+./ns3 build || exit 1
+
+# every point, REPS replications each, at most JOBS at a time
 for n in 20 40 60 80 100
 do
-    ./ns3 run "offline1 --nNodes=$n --fileName=Node$n.dat"
-    cat scratch/stats/Node$n.dat >> scratch/stats/Nodes.dat
-    rm -rf scratch/stats/Node$n.dat
+    sweep_run offline1 scratch/stats Node$n --nNodes=$n
 done
 
 for n in 10 20 30 40 50
 do
-    ./ns3 run "offline1 --nFlows=$n --fileName=Flow$n.dat" 
-    cat scratch/stats/Flow$n.dat >> scratch/stats/Flows.dat
-    rm -rf scratch/stats/Flow$n.dat
+    sweep_run offline1 scratch/stats Flow$n --nFlows=$n
+done
+
+for n in 1 2 3 4 5
+do
+    sweep_run offline1 scratch/stats Area$n --coverageAreaMultiplier=$n
+done
+
+for n in 100 200 300 400 500
+do
+    sweep_run offline1 scratch/stats Packet$n --nPackets=$n
 done
 
+sweep_wait || echo "some runs failed; their points average the replications that finished" >&2
+
+for n in 20 40 60 80 100
+do
+    sweep_collect scratch/stats Node$n scratch/stats/Nodes.dat
+done
+
+for n in 10 20 30 40 50
+do
+    sweep_collect scratch/stats Flow$n scratch/stats/Flows.dat
+done
 
 for n in 1 2 3 4 5
 do
-    ./ns3 run "offline1 --coverageAreaMultiplier=$n --fileName=Area$n.dat"
-    cat scratch/stats/Area$n.dat >> scratch/stats/Area.dat
-    rm -rf scratch/stats/Area$n.dat
+    sweep_collect scratch/stats Area$n scratch/stats/Area.dat
 done
 
 for n in 100 200 300 400 500
 do
-    ./ns3 run "offline1 --nPackets=$n --fileName=Packet$n.dat"
-    cat scratch/stats/Packet$n.dat >> scratch/stats/Packets.dat
-    rm -rf scratch/stats/Packet$n.dat
+    sweep_collect scratch/stats Packet$n scratch/stats/Packets.dat
 done
 
+# column 5 (throughput) and 6 (delivery ratio) are means; their 95% confidence half-widths are
+# columns 14 and 15, after the 13 columns of a single run
 echo 'set terminal png size 640,480;
 set output "scratch/plots/TPvsNodes.png";
-plot "scratch/stats/Nodes.dat" using 1:5 title "Nodes VS Throughput" with linespoints' | gnuplot
+plot "scratch/stats/Nodes.dat" using 1:5:14 title "Nodes VS Throughput" with yerrorlines' | gnuplot
 
 echo 'set terminal png size 640,480;
 set output "scratch/plots/DRvsNodes.png";
-plot "scratch/stats/Nodes.dat" using 1:6 title "Nodes VS Delivery Ratio" with linespoints' | gnuplot
+plot "scratch/stats/Nodes.dat" using 1:6:15 title "Nodes VS Delivery Ratio" with yerrorlines' | gnuplot
 
 echo 'set terminal png size 640,480;
 set output "scratch/plots/TPvsFlows.png";
-plot "scratch/stats/Flows.dat" using 2:5 title "Flows VS Throughput" with linespoints' | gnuplot
+plot "scratch/stats/Flows.dat" using 2:5:14 title "Flows VS Throughput" with yerrorlines' | gnuplot
 
 echo 'set terminal png size 640,480;
 set output "scratch/plots/DRvsFlows.png";
-plot "scratch/stats/Flows.dat" using 2:6 title "Flows VS Delivery Ratio" with linespoints' | gnuplot
+plot "scratch/stats/Flows.dat" using 2:6:15 title "Flows VS Delivery Ratio" with yerrorlines' | gnuplot
 
 
 echo 'set terminal png size 640,480;
 set output "scratch/plots/TPvsArea.png";
-plot "scratch/stats/Area.dat" using 3:5 title "Area VS Throughput" with linespoints' | gnuplot
+plot "scratch/stats/Area.dat" using 3:5:14 title "Area VS Throughput" with yerrorlines' | gnuplot
 
 echo 'set terminal png size 640,480;
 set output "scratch/plots/DRvsArea.png";
-plot "scratch/stats/Area.dat" using 3:6 title "Area VS Delivery Ratio" with linespoints' | gnuplot
+plot "scratch/stats/Area.dat" using 3:6:15 title "Area VS Delivery Ratio" with yerrorlines' | gnuplot
 
 echo 'set terminal png size 640,480;
 set output "scratch/plots/TPvsPackets.png";
-plot "scratch/stats/Packets.dat" using 4:5 title "Packets VS Throughput" with linespoints' | gnuplot
+plot "scratch/stats/Packets.dat" using 4:5:14 title "Packets VS Throughput" with yerrorlines' | gnuplot
 
 echo 'set terminal png size 640,480;
 set output "scratch/plots/DRvsPackets.png";
-plot "scratch/stats/Packets.dat" using 4:6 title "Packets VS Delivery Ratio" with linespoints' | gnuplot
+plot "scratch/stats/Packets.dat" using 4:6:15 title "Packets VS Delivery Ratio" with yerrorlines' | gnuplot
 
@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# Sourced by shell1.sh and shell2.sh: runs every sweep point REPS times with RngRun 1..REPS,
+# at most JOBS simulations at once, then averages the replications into one .dat line per point.
+#
+#   sweep_run PROGRAM DIR NAME ARGS...   queue the replications of one point
+#   sweep_wait                           wait for everything queued; fails if a run failed
+#   sweep_collect DIR NAME OUT           append the point's line to OUT
+#
+# Replication r of a point writes DIR/NAME.r$r.dat (plus .bins) and logs to DIR/NAME.r$r.log.
+# The collected line keeps the layout of a single run: columns 1-4 are the parameters, every
+# later column is the mean over the replications. After them come the 95% confidence half-widths
+# of columns 5..NF in the same order, then the number of replications.
+
+JOBS=${JOBS:-$(nproc)}
+REPS=${REPS:-5}
+SWEEP_FAILED=$(mktemp)
+trap 'rm -f "$SWEEP_FAILED"' EXIT
+
+# start "$@" in the background once fewer than JOBS jobs are running
+sweep_job() {
+    while [ "$(jobs -rp | wc -l)" -ge "$JOBS" ]; do
+        wait -n
+    done
+    "$@" &
+}
+
+# one replication; a failure is recorded rather than stopping the sweep
+sweep_replication() {
+    local program=$1 dir=$2 name=$3 r=$4
+    shift 4
+    if ! ./ns3 run --no-build "$program $* --RngRun=$r --fileName=$name.r$r.dat" > "$dir/$name.r$r.log" 2>&1; then
+        echo "$name replication $r failed, see $dir/$name.r$r.log" >> "$SWEEP_FAILED"
+    fi
+}
+
+sweep_run() {
+    local program=$1 dir=$2 name=$3
+    shift 3
+    for ((r = 1; r <= REPS; r++)); do
+        sweep_job sweep_replication "$program" "$dir" "$name" "$r" "$@"
+    done
+}
+
+sweep_wait() {
+    wait
+    if [ -s "$SWEEP_FAILED" ]; then
+        cat "$SWEEP_FAILED" >&2
+        return 1
+    fi
+}
+
+sweep_collect() {
+    local dir=$1 name=$2 out=$3
+    cat "$dir/$name".r*.dat | awk '
+        # two-sided 95% quantiles of Student t for 1..30 degrees of freedom, normal beyond
+        BEGIN {
+            split("12.706 4.303 3.182 2.776 2.571 2.447 2.365 2.306 2.262 2.228 " \
+                  "2.201 2.179 2.160 2.145 2.131 2.120 2.110 2.101 2.093 2.086 " \
+                  "2.080 2.074 2.069 2.064 2.060 2.056 2.052 2.048 2.045 2.042", t, " ")
+        }
+        {
+            n++
+            if (n == 1) { cols = NF; for (c = 1; c <= 4; c++) param[c] = $c }
+            for (c = 5; c <= cols; c++) { sum[c] += $c; sq[c] += $c * $c }
+        }
+        END {
+            if (n == 0) exit 1
+            q = n - 1 <= 30 ? t[n - 1] : 1.960
+            line = param[1]
+            for (c = 2; c <= 4; c++) line = line "\t" param[c]
+            for (c = 5; c <= cols; c++) line = line "\t" sum[c] / n
+            for (c = 5; c <= cols; c++) {
+                var = n > 1 ? (sq[c] - sum[c] * sum[c] / n) / (n - 1) : 0
+                line = line "\t" (var > 0 ? q * sqrt(var / n) : 0)
+            }
+            print line "\t" n
+        }' >> "$out"
+    rm -f "$dir/$name".r*.dat
+}
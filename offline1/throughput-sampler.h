@@ -0,0 +1,122 @@
+#ifndef THROUGHPUT_SAMPLER_H
+#define THROUGHPUT_SAMPLER_H
+
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Received bytes in fixed time bins, and the steady-state throughput after a warm-up.
+ *
+ * Bytes go into the bin of the current simulation time, an integer
+ * division of the time step. The bins live in a ring allocated up front,
+ * so a packet costs one division and two additions, and a run longer than
+ * the ring keeps its latest bins. The steady-state total is kept apart
+ * from the ring: it counts the bytes received in [warmup, end) and is
+ * not affected by bins being overwritten. Bytes received at or after
+ * \c end count nowhere.
+ */
+class ThroughputSampler
+{
+  public:
+    /**
+     * \param width bin width.
+     * \param capacity number of bins the ring holds.
+     * \param warmup start of the steady state.
+     * \param end end of the measurement, e.g. when the senders stop.
+     */
+    ThroughputSampler(Time width, uint32_t capacity, Time warmup, Time end)
+        : m_width(width.GetTimeStep()),
+          m_warmup(warmup.GetTimeStep()),
+          m_end(end.GetTimeStep()),
+          m_bins(std::max<uint32_t>(capacity, 1), 0),
+          m_first(0),
+          m_next(0),
+          m_steadyBytes(0)
+    {
+    }
+
+    /// Count \p bytes received now.
+    void Add(uint32_t bytes)
+    {
+        Add(Simulator::Now().GetTimeStep(), bytes);
+    }
+
+    /// Count \p bytes received at time step \p now; times must not decrease.
+    void Add(int64_t now, uint32_t bytes)
+    {
+        if (now >= m_end)
+        {
+            return;
+        }
+        uint64_t bin = now / m_width;
+        if (bin >= m_next)
+        {
+            Advance(bin + 1);
+        }
+        m_bins[bin % m_bins.size()] += bytes;
+        if (now >= m_warmup)
+        {
+            m_steadyBytes += bytes;
+        }
+    }
+
+    /// kbit/s over [warmup, end).
+    double SteadyThroughput() const
+    {
+        double seconds = Time(m_end - m_warmup).GetSeconds();
+        return seconds > 0 ? m_steadyBytes * 8.0 / seconds / 1000 : 0;
+    }
+
+    /// kbit/s of bin \p bin, 0 if it is no longer or not yet held.
+    double BinThroughput(uint64_t bin) const
+    {
+        if (bin < m_first || bin >= m_next)
+        {
+            return 0;
+        }
+        return m_bins[bin % m_bins.size()] * 8.0 / Time(m_width).GetSeconds() / 1000;
+    }
+
+    /// One line per held bin up to end: bin start in seconds and kbit/s.
+    void Print(std::ostream& os) const
+    {
+        uint64_t last = (m_end + m_width - 1) / m_width;
+        for (uint64_t bin = m_first; bin < last; bin++)
+        {
+            os << Time(bin * m_width).GetSeconds() << "\t" << BinThroughput(bin) << std::endl;
+        }
+    }
+
+  private:
+    /// Open bins up to \p next, clearing the ring slots they reuse.
+    void Advance(uint64_t next)
+    {
+        uint64_t size = m_bins.size();
+        for (uint64_t bin = std::max(m_next, next > size ? next - size : 0); bin < next; bin++)
+        {
+            m_bins[bin % size] = 0;
+        }
+        m_next = next;
+        m_first = next > size ? next - size : 0;
+    }
+
+    int64_t m_width;               //!< Bin width in time steps.
+    int64_t m_warmup;              //!< Start of the steady state in time steps.
+    int64_t m_end;                 //!< End of the measurement in time steps.
+    std::vector<uint64_t> m_bins;  //!< Bytes of bin b at b % size.
+    uint64_t m_first;              //!< Oldest bin held.
+    uint64_t m_next;               //!< One past the newest bin opened.
+    uint64_t m_steadyBytes;        //!< Bytes received in [warmup, end).
+};
+
+} // namespace ns3
+
+#endif /* THROUGHPUT_SAMPLER_H */
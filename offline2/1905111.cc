@@ -9,6 +9,8 @@
 #include "ns3/point-to-point-dumbbell.h"
 #include "ns3/flow-monitor-module.h"
 
+#include "codec-error-model.h"
+
 #include <fstream>
 
 using namespace ns3;
@@ -180,6 +182,10 @@ main(int argc, char* argv[])
     std::string outputFile = "tpByPktLossRate"; // tpByBottleneckDataRate
     bool verbose = true;
     int totalPackets = 1000;
+    bool fec = false;
+    uint32_t fecRowBytes = 4;
+    std::string fecGenerator = "10001000000100001";
+    uint32_t fecParity = 0;
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("totalPackets", "Number of packets to send", totalPackets);
@@ -190,6 +196,10 @@ main(int argc, char* argv[])
     cmd.AddValue("outputFolder", "Output folder", outputFolder);
     cmd.AddValue("outputFile", "Output file", outputFile);
     cmd.AddValue("verbose", "Tell echo applications to log if true", verbose);
+    cmd.AddValue("fec", "Bit errors with Hamming+CRC link FEC instead of dropping every hit packet", fec);
+    cmd.AddValue("fecRowBytes", "FEC data bytes per row (m)", fecRowBytes);
+    cmd.AddValue("fecGenerator", "FEC CRC generator polynomial", fecGenerator);
+    cmd.AddValue("fecParity", "Reed-Solomon parity bytes per row instead of Hamming, 0 for Hamming", fecParity);
 
     cmd.Parse(argc, argv);
 
@@ -214,8 +224,24 @@ main(int argc, char* argv[])
     pointToPointLeaf.SetQueue ("ns3::DropTailQueue", "MaxSize", StringValue (std::to_string (bandwidth_delay_product) + "p"));
     PointToPointDumbbellHelper d(nLeaf, pointToPointLeaf, nLeaf, pointToPointLeaf, bottleNeckLink);
 
-    Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
-    em->SetAttribute ("ErrorRate", DoubleValue (errorRate));
+    Ptr<ErrorModel> em;
+    Ptr<CodecErrorModel> fecModel;
+    if (fec)
+    {
+        // errorRate is the per-byte rate of RateErrorModel; the same byte error rate, spread over bits
+        fecModel = CreateObject<CodecErrorModel> ();
+        fecModel->SetAttribute ("RowBytes", UintegerValue (fecRowBytes));
+        fecModel->SetAttribute ("Generator", StringValue (fecGenerator));
+        fecModel->SetAttribute ("ReedSolomonParity", UintegerValue (fecParity));
+        fecModel->SetAttribute ("BitErrorRate", DoubleValue (1 - std::pow (1 - errorRate, 1.0 / 8)));
+        em = fecModel;
+    }
+    else
+    {
+        Ptr<RateErrorModel> rem = CreateObject<RateErrorModel> ();
+        rem->SetAttribute ("ErrorRate", DoubleValue (errorRate));
+        em = rem;
+    }
     d.m_routerDevices.Get (0)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
     d.m_routerDevices.Get (1)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
 
@@ -289,6 +315,8 @@ main(int argc, char* argv[])
         jainDenominator += pow(throughput, 2);
         jainNumerator += throughput;
     }
+    if(verbose && fec) std::cout << "FEC: " << fecModel->GetHitPackets() << " packets hit, " << fecModel->GetCorrectedPackets() << " corrected, "
+                                 << fecModel->GetDroppedPackets() << " dropped, " << fecModel->GetUndetectedPackets() << " undetected" << std::endl;
     if(verbose) std::cout << "BottleNeckDataRate: " << bottleNeckDataRate << " | ErrorRate: " << errorRate << " | Thoughput 1 : " << thoughputs[0] << " | Thoughput 2 : " << thoughputs[1] << std::endl;
     // take the log10 of the error rate
     double logErrorRate = log10(errorRate);
@@ -3,6 +3,12 @@
 file1="tpByPktLossRate"
 file2="tpByBottleneckDataRate"
 
+# optional third arg: "fec" to send through the Hamming+CRC error model instead of dropping every hit packet
+fec=false
+if [ "$3" = "fec" ]; then
+    fec=true
+fi
+
 # first arg is foldername
 # if folder name not empty
 if [ -n "$1" ]; then
@@ -13,13 +19,13 @@ fi
 # bottle data rate experiment ( 1, 50, 100, 150, 200, 250, 300 Mbps)
 for i in 1 50 100 150 200 250 300; do
     echo "Running experiment with bottleneck data rate = $i Mbps"
-    ./ns3 run "offline1 --totalPackets=10000000 --bottleNeckDataRate=$i --outputFolder=scratch/$1 --errorRate=0.000001 --outputFile=$file2 --verbose=false --tcp2=$2"
+    ./ns3 run "offline1 --totalPackets=10000000 --bottleNeckDataRate=$i --outputFolder=scratch/$1 --errorRate=0.000001 --outputFile=$file2 --verbose=false --tcp2=$2 --fec=$fec"
 done
 
 # packet loss rate experiment (0.000001, 0.00001, 0.0001, 0.001, 0.01)
 for i in 0.000001 0.00001 0.0001 0.001 0.01; do
     echo "Running experiment with packet loss rate = $i"
-    ./ns3 run "offline1 --totalPackets=10000000 --bottleNeckDataRate=50 --outputFolder=scratch/$1 --errorRate=$i --outputFile=$file1 --verbose=false --tcp2=$2"
+    ./ns3 run "offline1 --totalPackets=10000000 --bottleNeckDataRate=50 --outputFolder=scratch/$1 --errorRate=$i --outputFile=$file1 --verbose=false --tcp2=$2 --fec=$fec"
 done
 
 gnuplot -persist <<EOFMarker
@@ -50,7 +56,7 @@ gnuplot -persist <<EOFMarker
     plot "scratch/$1/$file1.txt" using 2:5 title "JI" with linespoints;
 EOFMarker
 
-./ns3 run "offline1 --totalPackets=10000000 --bottleNeckDataRate=150 --outputFolder=scratch/$1 --errorRate=0.001 --outputFile=temp --verbose=false --tcp2=$2"
+./ns3 run "offline1 --totalPackets=10000000 --bottleNeckDataRate=150 --outputFolder=scratch/$1 --errorRate=0.001 --outputFile=temp --verbose=false --tcp2=$2 --fec=$fec"
 
 gnuplot -persist <<EOFMarker
     set terminal png size 640,480;
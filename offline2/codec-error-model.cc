@@ -0,0 +1,274 @@
+#include "codec-error-model.h"
+
+#include "ns3/abort.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include <cmath>
+#include <exception>
+
+NS_LOG_COMPONENT_DEFINE("CodecErrorModel");
+
+namespace ns3
+{
+
+NS_OBJECT_ENSURE_REGISTERED(CodecErrorModel);
+
+TypeId
+CodecErrorModel::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::CodecErrorModel")
+            .SetParent<ErrorModel>()
+            .SetGroupName("Network")
+            .AddConstructor<CodecErrorModel>()
+            .AddAttribute("RowBytes",
+                          "Data bytes per codec row (m)",
+                          UintegerValue(4),
+                          MakeUintegerAccessor(&CodecErrorModel::SetRowBytes, &CodecErrorModel::GetRowBytes),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("Generator",
+                          "CRC generator polynomial as a bit string",
+                          StringValue("10001000000100001"),
+                          MakeStringAccessor(&CodecErrorModel::SetGenerator, &CodecErrorModel::GetGenerator),
+                          MakeStringChecker())
+            .AddAttribute("ReedSolomonParity",
+                          "Reed-Solomon parity bytes per row instead of Hamming check bits; 0 for Hamming",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&CodecErrorModel::SetReedSolomonParity,
+                                               &CodecErrorModel::GetReedSolomonParity),
+                          MakeUintegerChecker<uint32_t>(0, 254))
+            .AddAttribute("BitErrorRate",
+                          "Probability that a bit of the encoded frame is flipped",
+                          DoubleValue(0.0),
+                          MakeDoubleAccessor(&CodecErrorModel::SetBitErrorRate, &CodecErrorModel::GetBitErrorRate),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("RanVar",
+                          "The random variable that seeds the bit error process",
+                          StringValue("ns3::UniformRandomVariable[Min=0.0|Max=1.0]"),
+                          MakePointerAccessor(&CodecErrorModel::m_ranvar),
+                          MakePointerChecker<RandomVariableStream>())
+            .AddTraceSource("Corrected",
+                            "A packet hit by bit errors that the codec restored",
+                            MakeTraceSourceAccessor(&CodecErrorModel::m_correctedTrace),
+                            "ns3::CodecErrorModel::CorrectedTracedCallback");
+    return tid;
+}
+
+CodecErrorModel::CodecErrorModel()
+    : m_m(4),
+      m_generator("10001000000100001"),
+      m_rsParity(0),
+      m_p(0),
+      m_logq(0),
+      m_seeded(false),
+      m_gap(0),
+      m_hit(0),
+      m_corrected(0),
+      m_dropped(0),
+      m_undetected(0)
+{
+    NS_LOG_FUNCTION(this);
+    BuildCodec();
+}
+
+CodecErrorModel::~CodecErrorModel()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+CodecErrorModel::SetRowBytes(uint32_t m)
+{
+    NS_LOG_FUNCTION(this << m);
+    m_m = m;
+    BuildCodec();
+}
+
+uint32_t
+CodecErrorModel::GetRowBytes() const
+{
+    return m_m;
+}
+
+void
+CodecErrorModel::SetGenerator(std::string generator)
+{
+    NS_LOG_FUNCTION(this << generator);
+    m_generator = generator;
+    BuildCodec();
+}
+
+std::string
+CodecErrorModel::GetGenerator() const
+{
+    return m_generator;
+}
+
+void
+CodecErrorModel::SetReedSolomonParity(uint32_t parity)
+{
+    NS_LOG_FUNCTION(this << parity);
+    m_rsParity = parity;
+    BuildCodec();
+}
+
+uint32_t
+CodecErrorModel::GetReedSolomonParity() const
+{
+    return m_rsParity;
+}
+
+void
+CodecErrorModel::SetBitErrorRate(double p)
+{
+    NS_LOG_FUNCTION(this << p);
+    m_p = p;
+    m_logq = p < 1 ? std::log1p(-p) : -INFINITY; // a gap of 0 for p = 1
+    m_seeded = false;
+}
+
+double
+CodecErrorModel::GetBitErrorRate() const
+{
+    return m_p;
+}
+
+int64_t
+CodecErrorModel::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+    m_ranvar->SetStream(stream);
+    m_seeded = false;
+    return 1;
+}
+
+uint64_t
+CodecErrorModel::GetHitPackets() const
+{
+    return m_hit;
+}
+
+uint64_t
+CodecErrorModel::GetCorrectedPackets() const
+{
+    return m_corrected;
+}
+
+uint64_t
+CodecErrorModel::GetDroppedPackets() const
+{
+    return m_dropped;
+}
+
+uint64_t
+CodecErrorModel::GetUndetectedPackets() const
+{
+    return m_undetected;
+}
+
+void
+CodecErrorModel::BuildCodec()
+{
+    try
+    {
+        m_codec = std::make_unique<Codec>(m_m, m_generator, true, m_rsParity);
+    }
+    catch (const std::exception& e)
+    {
+        NS_ABORT_MSG("CodecErrorModel: RowBytes " << m_m << ", Generator " << m_generator
+                                                  << ", ReedSolomonParity " << m_rsParity << ": " << e.what());
+    }
+}
+
+const Codec&
+CodecErrorModel::GetCodec() const
+{
+    return *m_codec;
+}
+
+uint64_t
+CodecErrorModel::NextGap()
+{
+    return GeometricGap(m_rng, m_logq);
+}
+
+bool
+CodecErrorModel::DoCorrupt(Ptr<Packet> p)
+{
+    NS_LOG_FUNCTION(this << p);
+    if (m_p <= 0)
+    {
+        return false;
+    }
+    if (!m_seeded)
+    {
+        uint64_t hi = (uint64_t)std::ldexp(m_ranvar->GetValue(), 32);
+        uint64_t lo = (uint64_t)std::ldexp(m_ranvar->GetValue(), 32);
+        m_rng.Seed(hi << 32 ^ lo);
+        m_gap = NextGap();
+        m_seeded = true;
+    }
+    size_t nbits = GetCodec().FrameBits(p->GetSize());
+    if (m_gap >= nbits)
+    {
+        m_gap -= nbits;
+        return false;
+    }
+    m_hit++;
+    return Transmit(p, nbits);
+}
+
+bool
+CodecErrorModel::Transmit(Ptr<const Packet> p, size_t nbits)
+{
+    const Codec& codec = GetCodec();
+    m_bytes.resize(p->GetSize());
+    p->CopyData(m_bytes.data(), m_bytes.size());
+    codec.DataBlock((const char*)m_bytes.data(), m_bytes.size(), m_data);
+    codec.AddCheckBits(m_data, m_code);
+    codec.Serialize(m_code, m_sent);
+    m_frame = m_sent;
+    codec.AppendCrcInPlace(m_frame);
+    uint64_t pos = m_gap;
+    for (; pos < nbits; pos += 1 + NextGap())
+    {
+        m_frame.Flip(pos);
+    }
+    m_gap = pos - nbits;
+
+    // the receiver corrects the rows, then checks the corrected frame against the received checksum
+    codec.Deserialize(m_frame, m_received);
+    uint32_t rows = codec.CorrectRows(m_received);
+    codec.Serialize(m_received, m_payload);
+    unsigned degree = codec.Crc().Degree();
+    uint64_t received = degree ? m_frame.GetBits(m_payload.Size(), degree) : 0;
+    if (codec.Checksum(m_payload, m_payload.Size()) != received)
+    {
+        NS_LOG_DEBUG("packet " << p->GetUid() << " dropped, " << rows << " rows corrected");
+        m_dropped++;
+        return true;
+    }
+    if (!(m_payload == m_sent))
+    {
+        NS_LOG_DEBUG("packet " << p->GetUid() << " passed with an undetected error");
+        m_undetected++;
+        return false;
+    }
+    m_corrected++;
+    m_correctedTrace(p, rows);
+    return false;
+}
+
+void
+CodecErrorModel::DoReset()
+{
+    NS_LOG_FUNCTION(this);
+    m_hit = m_corrected = m_dropped = m_undetected = 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,141 @@
+#ifndef CODEC_ERROR_MODEL_H
+#define CODEC_ERROR_MODEL_H
+
+#include "ns3/error-model.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+
+// the header-only codec of offline3; its headers go next to this file in the scratch directory
+#include "bitblock.h"
+#include "channel.h"
+#include "codec.h"
+#include "rng.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup errormodel
+ *
+ * \brief Bit errors with link-layer FEC: each hit packet goes through the Hamming-row + CRC codec.
+ *
+ * Bits of the encoded frame are flipped independently with probability
+ * BitErrorRate. The receiver corrects every row, recomputes the CRC over
+ * the corrected frame and compares it with the received checksum.
+ * Packets whose errors the rows fix pass; packets with a checksum
+ * mismatch are dropped. A residual error the CRC misses would reach the
+ * upper layers corrupted on a real link, so such packets also pass, and
+ * they are counted apart.
+ *
+ * The gap to the next flipped bit is drawn from the geometric
+ * distribution and carried from packet to packet. A packet the gap
+ * skips costs a subtraction, since a clean frame always decodes; only hit
+ * packets are copied, encoded and decoded. They go through blocks and bit
+ * strings the model keeps, so a hit packet no larger than an earlier one
+ * does not allocate. At the bit error rates of a loss-rate sweep hit
+ * packets are a small share, which keeps a 300 Mbps bottleneck run
+ * affordable.
+ */
+class CodecErrorModel : public ErrorModel
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    /**
+     * TracedCallback signature for packets the codec restored.
+     * \param [in] packet The packet.
+     * \param [in] rows Rows with a non-zero syndrome.
+     */
+    typedef void (*CorrectedTracedCallback)(Ptr<const Packet> packet, uint32_t rows);
+
+    CodecErrorModel();
+    ~CodecErrorModel() override;
+
+    void SetRowBytes(uint32_t m);
+    uint32_t GetRowBytes() const;
+
+    void SetGenerator(std::string generator);
+    std::string GetGenerator() const;
+
+    void SetReedSolomonParity(uint32_t parity);
+    uint32_t GetReedSolomonParity() const;
+
+    void SetBitErrorRate(double p);
+    double GetBitErrorRate() const;
+
+    /**
+     * \brief Assign a fixed random variable stream number to the random variables used by this model.
+     * \param stream first stream index to use
+     * \return the number of stream indices assigned by this model
+     */
+    int64_t AssignStreams(int64_t stream);
+
+    uint64_t GetHitPackets() const;        //!< Packets with at least one flipped bit.
+    uint64_t GetCorrectedPackets() const;  //!< Hit packets the codec restored.
+    uint64_t GetDroppedPackets() const;    //!< Hit packets the CRC rejected.
+    uint64_t GetUndetectedPackets() const; //!< Hit packets passed with a residual error.
+
+  private:
+    bool DoCorrupt(Ptr<Packet> p) override;
+    void DoReset() override;
+
+    /**
+     * \brief Build the codec for the current attributes.
+     *
+     * Called by the constructor and every codec attribute setter, so a bad
+     * generator or a row wider than Reed-Solomon allows aborts the
+     * configuration instead of the first hit packet.
+     */
+    void BuildCodec();
+
+    const Codec& GetCodec() const;
+
+    /// Untouched bits before the next flipped one.
+    uint64_t NextGap();
+
+    /**
+     * \brief Encode the bytes of \p p, flip the bits the gap process picks up to \p nbits and decode.
+     * \return true if the receiver rejects the frame.
+     */
+    bool Transmit(Ptr<const Packet> p, size_t nbits);
+
+    uint32_t m_m;             //!< Data bytes per row.
+    std::string m_generator;  //!< CRC generator bit string.
+    uint32_t m_rsParity;      //!< Reed-Solomon parity bytes per row; 0 for Hamming rows.
+    double m_p;               //!< Bit error rate.
+    double m_logq;            //!< log(1 - p).
+    Ptr<RandomVariableStream> m_ranvar; //!< Seeds m_rng, so that runs follow RngRun.
+
+    std::unique_ptr<Codec> m_codec; //!< Built from the current attributes.
+    Xoshiro256 m_rng;               //!< Draws the gaps.
+    bool m_seeded;                  //!< m_rng has been seeded from m_ranvar.
+    uint64_t m_gap;                 //!< Untouched bits left before the next flip.
+
+    std::vector<uint8_t> m_bytes; //!< Bytes of the current hit packet.
+    BitBlock m_data;              //!< Its data rows.
+    BitBlock m_code;              //!< Its code rows.
+    BitVec m_sent;                //!< Its serialized rows as sent.
+    BitVec m_frame;               //!< Its frame, sent and then received.
+    BitBlock m_received;          //!< The received rows, corrected in place.
+    BitVec m_payload;             //!< The received rows after correction, serialized.
+
+    uint64_t m_hit;
+    uint64_t m_corrected;
+    uint64_t m_dropped;
+    uint64_t m_undetected;
+
+    TracedCallback<Ptr<const Packet>, uint32_t> m_correctedTrace; //!< Packet and rows corrected.
+};
+
+} // namespace ns3
+
+#endif /* CODEC_ERROR_MODEL_H */
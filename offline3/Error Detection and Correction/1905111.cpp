@@ -1,7 +1,499 @@
 #include<bits/stdc++.h>
 
+#include "batch.h"
+#include "bench.h"
+#include "bench_suite.h"
+#include "bitblock.h"
+#include "channel.h"
+#include "codec.h"
+#include "fuzz.h"
+#include "pipeline.h"
+#include "metrics.h"
+#include "rare.h"
+#include "render.h"
+#include "stream.h"
+#include "sweep.h"
+
 using namespace std;
 
-int main(){
-    
-}
\ No newline at end of file
+// build: g++ -O2 -o a.out 1905111.cpp
+// (alloc_check.cpp is a separate program that checks the span API for heap allocations)
+// usage: ./a.out [--seed=N] [--color=auto|always|never] [--quiet]
+//                             interactive run of the spec pipeline, N fixes the channel errors; colors only
+//                             on a terminal unless --color says otherwise; --quiet (or --stats-only) skips
+//                             the stage dumps and prints the result counts and the output frame
+//        ./a.out --batch[=PATH] [--format=summary|full] [--threads=N] [--seed=N] [--color=...]
+//                             many cases from PATH or stdin, one per line: data, m, p, generator and an
+//                             optional seed (default: --seed plus the case number), separated by tabs; run on
+//                             a thread pool, results in input order as one summary line or the full dump each
+//        ./a.out --bench      kernel benchmarks
+//        ./a.out --bench-suite [--sizes=LIST] [--m=LIST] [--p=LIST] [--gen=LIST] [--min-time=S] [--out=PATH]
+//                             [--baseline=PATH] [--tolerance=F]
+//                             throughput and cycles/bit of every kernel per message size (default 1 KiB to
+//                             32 MiB, up to 1e9 if memory allows), tab-separated to --out or stdout; with
+//                             --baseline, exit status 4 if any kernel got slower by more than F (default 0.2)
+//        ./a.out --fuzz [--trials=N] [--length=N] [--seed=N] [--fuzz-case=I]
+//                             differential test of every codec stage (generic and kernel paths, fused
+//                             receiver, span API) against the one-char-per-bit reference in reference.h,
+//                             and of the Reed-Solomon rows against a slow encoder and their correction bound,
+//                             plus the mean bit error rate of a random channel model against its p;
+//                             N random cases of up to N bytes, or only case I; exit status 5 on a mismatch
+//        --channel=SPEC with an interactive run, --sweep or --stream: the error model, at mean
+//                             bit error rate p: iid (default), ge:B[,BAD[,GOOD]] (Gilbert-Elliott bursts of mean
+//                             B bits, state error rates BAD = 0.5 and GOOD = 0), burst:L (bursts of length L) or
+//                             mask:PATH (replay a recorded '0'/'1' error mask, p unused)
+//        --rs=N with an interactive run, --sweep, --stream or --bench-suite: Reed-Solomon rows
+//                             over GF(256) with N parity bytes (corrects N/2 bytes per row, m + N <= 255)
+//                             in place of the Hamming check bits
+//        --metrics=json|csv [--metrics-file=PATH] with an interactive run or --sweep: stage times, bits/s
+//                             and event counts, one record per run or sweep point, to stderr by default
+//        ./a.out --sweep --p=LIST --m=LIST --gen=LIST [--trials=N] [--length=N] [--threads=N] [--seed=N]
+//                             Monte-Carlo error rates, one tab-separated line per (p, m, gen)
+//        ./a.out --rare --p=LIST --m=LIST --gen=LIST [--weights=K] [--trials=N] [--exact-limit=N] [--length=N] [--threads=N] [--seed=N]
+//                             undetected / residual error probabilities for tiny p, by error weight up to K
+//        ./a.out --stream --m=N --gen=G [--p=P] [--file=PATH] [--chunk=BYTES] [--seed=N] [--quiet] [--pipeline[=DEPTH]]
+//                             encode / send / decode stdin or a file chunk by chunk, decoded bytes to stdout,
+//                             summary to stderr; --pipeline runs every stage on its own thread and reports
+//                             where each stage spent its time
+//        a LIST is "a,b,c", "lo:hi:xK" (multiply by K) or "lo:hi:+D" (add D)
+
+vector<double> parseList(const string& s){
+    vector<double> values;
+    size_t c1 = s.find(':');
+    if(c1 == string::npos){
+        stringstream ss(s);
+        string item;
+        while(getline(ss, item, ',')) values.push_back(stod(item));
+        return values;
+    }
+    size_t c2 = s.find(':', c1 + 1);
+    double lo = stod(s.substr(0, c1)), hi = stod(s.substr(c1 + 1, c2 - c1 - 1));
+    string step = s.substr(c2 + 1);
+    double k = stod(step.substr(1));
+    if(step[0] == 'x' && k > 1) for(double v = lo; v <= hi * (1 + 1e-9); v *= k) values.push_back(v);
+    else if(step[0] == '+' && k > 0) for(double v = lo; v <= hi + k * 1e-9; v += k) values.push_back(v);
+    else throw invalid_argument("bad range step " + step);
+    return values;
+}
+
+// runs the whole spec pipeline for one input set and prints every stage, timing the stages into metrics
+void runCodec(string data, const Codec& codec, const Channel& channel, uint64_t seed, Renderer& out, CodecMetrics* metrics){
+    // 1. padding
+    data = Timed(metrics, STAGE_PAD, 8 * data.size(), [&]{ return codec.Pad(data); });
+    out.Text("\n\ndata string after padding: " + data + "\n\n");
+
+    // 2. data block
+    BitBlock block = Timed(metrics, STAGE_BLOCK, 8 * data.size(), [&]{ return codec.DataBlock(data); });
+    out.Text("data block (ascii code of m characters per row):\n");
+    for(size_t r = 0; r < block.Rows(); r++) out.Bits(block.Bits(), r * block.Cols(), block.Cols()).Text("\n");
+    out.Text("\n");
+
+    // 3. hamming check bits, drawn in green
+    BitBlock encoded = Timed(metrics, STAGE_ENCODE, block.Bits().Size(), [&]{ return codec.AddCheckBits(block); });
+    out.Text("data block after adding check bits:\n");
+    for(size_t r = 0; r < encoded.Rows(); r++){
+        size_t row = r * encoded.Cols();
+        out.MaskedBits(encoded.Bits(), row, encoded.Cols(), Renderer::GREEN, [&](size_t i, unsigned k){
+            uint64_t mask = 0;
+            for(unsigned j = 0; j < k; j++) mask = (mask << 1) | codec.IsCheckColumn(i + j - row);
+            return mask;
+        });
+        out.Text("\n");
+    }
+    out.Text("\n");
+
+    // 4. column-major serialization
+    BitVec serialized = Timed(metrics, STAGE_SERIALIZE, encoded.Bits().Size(), [&]{ return codec.Serialize(encoded); });
+    out.Text("data bits after column-wise serialization:\n").Bits(serialized, 0, serialized.Size()).Text("\n\n");
+
+    // 5. crc checksum
+    BitVec frame = Timed(metrics, STAGE_CRC, serialized.Size(), [&]{ return codec.AppendCrc(serialized); });
+    out.Text("data bits after appending CRC checksum (sent frame):\n");
+    out.Bits(frame, 0, serialized.Size()).Bits(frame, serialized.Size(), codec.Crc().Degree(), Renderer::CYAN);
+    out.Text("\n\n");
+
+    // 6. channel
+    Xoshiro256 rng(seed);
+    BitVec received = frame;
+    size_t flips = Timed(metrics, STAGE_CHANNEL, received.Size(), [&]{ return channel.Apply(received, rng); });
+    out.Text("received frame:\n").DiffBits(received, 0, received.Size(), frame).Text("\n\n");
+
+    // 7. crc verification, the received frame must leave no remainder
+    bool ok = Timed(metrics, STAGE_VERIFY, received.Size(), [&]{ return codec.CheckCrc(received); });
+    out.Text(string("result of CRC checksum matching: ") + (ok ? "no error detected" : "error detected") + "\n\n");
+
+    // 8. de-serialization
+    BitBlock receivedBlock = Timed(metrics, STAGE_DESERIALIZE, received.Size(), [&]{ return codec.Deserialize(received); });
+    out.Text("data block after removing CRC checksum bits:\n");
+    for(size_t r = 0; r < receivedBlock.Rows(); r++){
+        out.DiffBits(receivedBlock.Bits(), r * receivedBlock.Cols(), receivedBlock.Cols(), encoded.Bits()).Text("\n");
+    }
+    out.Text("\n");
+
+    // 9. hamming correction
+    size_t codeBits = receivedBlock.Bits().Size();
+    size_t rowsCorrected = Timed(metrics, STAGE_CORRECT, codeBits, [&]{ return codec.CorrectRows(receivedBlock); });
+    BitBlock corrected = Timed(metrics, STAGE_DECODE, codeBits, [&]{ return codec.RemoveCheckBits(receivedBlock); });
+    out.Text("data block after removing check bits:\n");
+    for(size_t r = 0; r < corrected.Rows(); r++) out.Bits(corrected.Bits(), r * corrected.Cols(), corrected.Cols()).Text("\n");
+    out.Text("\n");
+
+    // 10. back to ascii
+    out.Text("output frame: " + Codec::Ascii(corrected) + "\n");
+
+    if(metrics){
+        size_t wrongRows = 0;
+        for(size_t r = 0; r < corrected.Rows(); r++) wrongRows += !corrected.RowEquals(block, r);
+        metrics->frames++;
+        metrics->bitsFlipped += flips;
+        metrics->crcRejects += !ok;
+        metrics->rowsCorrected += rowsCorrected;
+        metrics->rowsUncorrectable += wrongRows;
+        metrics->undetected += ok && wrongRows;
+    }
+}
+
+// --quiet: the same run as runCodec through the fused receiver, without rendering any stage
+void runStats(const string& data, const Codec& codec, const Channel& channel, uint64_t seed, CodecMetrics* metrics){
+    string padded = Timed(metrics, STAGE_PAD, 8 * data.size(), [&]{ return codec.Pad(data); });
+    BitBlock block = Timed(metrics, STAGE_BLOCK, 8 * padded.size(), [&]{ return codec.DataBlock(padded); });
+    BitBlock encoded = Timed(metrics, STAGE_ENCODE, block.Bits().Size(), [&]{ return codec.AddCheckBits(block); });
+    BitVec serialized = Timed(metrics, STAGE_SERIALIZE, encoded.Bits().Size(), [&]{ return codec.Serialize(encoded); });
+    BitVec frame = Timed(metrics, STAGE_CRC, serialized.Size(), [&]{ return codec.AppendCrc(serialized); });
+    Xoshiro256 rng(seed);
+    size_t flips = Timed(metrics, STAGE_CHANNEL, frame.Size(), [&]{ return channel.Apply(frame, rng); });
+    string decoded(codec.FrameRows(frame) * codec.M(), '\0');
+    ReceiveResult rx = Timed(metrics, STAGE_RECEIVE, frame.Size(), [&]{ return codec.Receive(frame, &decoded[0]); });
+    printf("frame bits: %zu  flipped bits: %zu  crc: %s  rows corrected: %zu\noutput frame: ", frame.Size(), flips,
+           rx.crcOk ? "no error detected" : "error detected", rx.rowsCorrected);
+    fwrite(decoded.data(), 1, decoded.size(), stdout); // the characters may include NUL
+    printf("\n");
+
+    if(metrics){
+        size_t wrongRows = 0, m = codec.M();
+        for(size_t r = 0; r < decoded.size() / m; r++) wrongRows += padded.compare(r * m, m, decoded, r * m, m) != 0;
+        metrics->frames++;
+        metrics->bitsFlipped += flips;
+        metrics->crcRejects += !rx.crcOk;
+        metrics->rowsCorrected += rx.rowsCorrected;
+        metrics->rowsUncorrectable += wrongRows;
+        metrics->undetected += rx.crcOk && wrongRows;
+    }
+}
+
+// backslash-escapes control characters, backslashes and bytes above 126 so that any text fits on one line
+string escapeText(const string& s){
+    string out;
+    char hex[8];
+    for(unsigned char ch : s){
+        if(ch == '\\') out += "\\\\";
+        else if(ch == '\t') out += "\\t";
+        else if(ch == '\n') out += "\\n";
+        else if(ch >= 32 && ch < 127) out += (char)ch;
+        else{
+            snprintf(hex, sizeof hex, "\\x%02x", ch);
+            out += hex;
+        }
+    }
+    return out;
+}
+
+// one batch case through the fused receiver, like runStats, as a tab-separated summary line
+string batchSummary(const BatchCase& c, const Codec& codec, const Channel& channel){
+    BitVec frame = codec.AppendCrc(codec.Serialize(codec.AddCheckBits(codec.DataBlock(codec.Pad(c.data)))));
+    Xoshiro256 rng(c.seed);
+    size_t flips = channel.Apply(frame, rng);
+    string padded = codec.Pad(c.data), decoded(codec.FrameRows(frame) * c.m, '\0');
+    ReceiveResult rx = codec.Receive(frame, &decoded[0]);
+    size_t wrongRows = 0;
+    for(size_t r = 0; r < decoded.size() / c.m; r++) wrongRows += padded.compare(r * c.m, c.m, decoded, r * c.m, c.m) != 0;
+    ostringstream line;
+    line << c.line << '\t' << c.m << '\t' << c.p << '\t' << c.generator << '\t' << c.seed << '\t' << frame.Size() << '\t'
+         << flips << '\t' << (rx.crcOk ? "ok" : "error") << '\t' << rx.rowsCorrected << '\t' << wrongRows << '\t'
+         << escapeText(decoded) << '\n';
+    return line.str();
+}
+
+// one batch case as a summary line or the full runCodec dump; a case that cannot run yields an error line
+// (a mask channel is loaded once by the caller and shared; the other models are built for the case's p)
+string runBatchCase(const BatchCase& c, bool full, Renderer::ColorMode color, const string& channelSpec,
+                    const Channel& mask, size_t rsParity, atomic<size_t>& errors){
+    try{
+        if(!c.error.empty()) throw invalid_argument(c.error);
+        Codec codec(c.m, c.generator, true, rsParity);
+        Channel ch = channelSpec.rfind("mask:", 0) == 0 ? mask : Channel::Parse(channelSpec, c.p);
+        if(!full) return batchSummary(c, codec, ch);
+        Renderer out(-1, color);
+        ostringstream head;
+        head << "== line " << c.line << ": m " << c.m << ", p " << c.p << ", generator " << c.generator << ", seed " << c.seed;
+        out.Text(head.str());
+        runCodec(c.data, codec, ch, c.seed, out, nullptr);
+        out.Text("\n");
+        return out.Take();
+    }
+    catch(const exception& e){
+        errors++;
+        return "#line " + to_string(c.line) + ": " + e.what() + "\n";
+    }
+}
+
+// appends one metrics record per point to path (stderr if empty), a CSV header first if the file is new
+void writeMetrics(MetricsFormat format, const string& path, const vector<SweepPoint>& points,
+                  const vector<CodecMetrics>& metrics){
+    FILE* out = path.empty() ? stderr : fopen(path.c_str(), "a");
+    if(!out) throw runtime_error("cannot open " + path);
+    bool fresh = path.empty() || (fseek(out, 0, SEEK_END) == 0 && ftell(out) == 0);
+    if(format == METRICS_CSV && fresh) WriteMetricsHeader(out);
+    for(size_t i = 0; i < points.size(); i++) WriteMetrics(out, format, points[i].p, points[i].m, points[i].generator, metrics[i]);
+    if(out != stderr) fclose(out);
+}
+
+int main(int argc, char* argv[]){
+    uint64_t seed = ((uint64_t)random_device{}() << 32) | random_device{}();
+    bool sweep = false, rare = false, stream = false, quiet = false;
+    Renderer::ColorMode color = Renderer::COLOR_AUTO;
+    MetricsFormat metricsFormat = METRICS_NONE;
+    bool benchSuite = false, fuzz = false, batch = false, fullFormat = false;
+    string batchFile = "-";
+    long long fuzzCase = -1;
+    BenchSuiteOptions benchOpt;
+    string benchOut, baseline;
+    double tolerance = 0.2;
+    string metricsFile;
+    string channelSpec = "iid";
+    size_t rsParity = 0;
+    string file = "-";
+    size_t chunkBytes = 65536, depth = 0;
+    vector<double> ps, ms;
+    vector<string> gens;
+    SweepOptions opt;
+    RareOptions rareOpt;
+    try{
+        for(int i = 1; i < argc; i++){
+            string arg = argv[i];
+            string value = arg.substr(arg.find('=') + 1);
+            if(arg == "--bench"){
+                BenchTranspose();
+                BenchHamming();
+                BenchCrc();
+                BenchFixedKernels();
+                BenchReceive();
+                return 0;
+            }
+            else if(arg == "--bench-suite") benchSuite = true;
+            else if(arg == "--batch") batch = true;
+            else if(arg.rfind("--batch=", 0) == 0){
+                batch = true;
+                batchFile = value;
+            }
+            else if(arg == "--format=full" || arg == "--format=summary") fullFormat = value == "full";
+            else if(arg.rfind("--sizes=", 0) == 0){
+                benchOpt.sizes.clear();
+                for(double v : parseList(value)) benchOpt.sizes.push_back((size_t)v);
+            }
+            else if(arg.rfind("--min-time=", 0) == 0) benchOpt.minSeconds = stod(value);
+            else if(arg.rfind("--out=", 0) == 0) benchOut = value;
+            else if(arg.rfind("--baseline=", 0) == 0) baseline = value;
+            else if(arg.rfind("--tolerance=", 0) == 0) tolerance = stod(value);
+            else if(arg == "--fuzz") fuzz = true;
+            else if(arg.rfind("--fuzz-case=", 0) == 0) fuzzCase = stoll(value);
+            else if(arg == "--sweep") sweep = true;
+            else if(arg == "--rare") rare = true;
+            else if(arg == "--stream") stream = true;
+            else if(arg == "--quiet" || arg == "--stats-only") quiet = true;
+            else if(arg.rfind("--color=", 0) == 0) color = Renderer::ParseMode(value);
+            else if(arg.rfind("--channel=", 0) == 0) channelSpec = value;
+            else if(arg.rfind("--rs=", 0) == 0) rsParity = stoull(value);
+            else if(arg.rfind("--metrics=", 0) == 0) metricsFormat = ParseMetricsFormat(value);
+            else if(arg.rfind("--metrics-file=", 0) == 0) metricsFile = value;
+            else if(arg == "--pipeline") depth = 8;
+            else if(arg.rfind("--pipeline=", 0) == 0) depth = max<size_t>(stoull(value), 1);
+            else if(arg.rfind("--file=", 0) == 0) file = value;
+            else if(arg.rfind("--chunk=", 0) == 0) chunkBytes = stoull(value);
+            else if(arg.rfind("--seed=", 0) == 0) seed = stoull(value);
+            else if(arg.rfind("--p=", 0) == 0) ps = parseList(value);
+            else if(arg.rfind("--m=", 0) == 0) ms = parseList(value);
+            else if(arg.rfind("--gen=", 0) == 0){
+                stringstream ss(value);
+                string g;
+                while(getline(ss, g, ',')) gens.push_back(g);
+            }
+            else if(arg.rfind("--trials=", 0) == 0) opt.trials = rareOpt.trials = stoull(value);
+            else if(arg.rfind("--length=", 0) == 0) opt.length = rareOpt.length = stoull(value);
+            else if(arg.rfind("--threads=", 0) == 0) opt.threads = rareOpt.threads = stoull(value);
+            else if(arg.rfind("--weights=", 0) == 0) rareOpt.maxWeight = stoull(value);
+            else if(arg.rfind("--exact-limit=", 0) == 0) rareOpt.exactLimit = stoull(value);
+            else{
+                cout << "unknown option " << arg << endl;
+                return 1;
+            }
+        }
+        if(benchSuite){
+            if(!ms.empty()){
+                benchOpt.ms.clear();
+                for(double m : ms){
+                    if(m < 1) throw invalid_argument("m must be >= 1");
+                    benchOpt.ms.push_back((size_t)m);
+                }
+            }
+            if(!ps.empty()) benchOpt.ps = ps;
+            if(!gens.empty()) benchOpt.generators = gens;
+            if(rsParity) benchOpt.rsParity = {rsParity};
+            for(size_t b : benchOpt.sizes) if(b == 0) throw invalid_argument("sizes must be positive");
+            map<string, BenchRecord> base;
+            if(!baseline.empty()) base = ReadBenchRecords(baseline); // fail before the long run, not after
+            FILE* out = benchOut.empty() ? stdout : fopen(benchOut.c_str(), "w");
+            if(!out) throw runtime_error("cannot open " + benchOut);
+            vector<BenchRecord> records = RunBenchSuite(benchOpt, stderr);
+            WriteBenchRecords(out, records);
+            if(out != stdout) fclose(out);
+            if(baseline.empty()) return 0;
+            fflush(stdout);
+            return CompareBench(records, base, tolerance, stderr) ? 4 : 0;
+        }
+        if(batch){
+            ifstream file;
+            if(batchFile != "-"){
+                file.open(batchFile);
+                if(!file) throw runtime_error("cannot open " + batchFile);
+            }
+            istream& in = batchFile == "-" ? cin : file;
+            Channel mask = channelSpec.rfind("mask:", 0) == 0 ? Channel::Parse(channelSpec, 0) : Channel();
+            if(color == Renderer::COLOR_AUTO) color = isatty(STDOUT_FILENO) ? Renderer::COLOR_ALWAYS : Renderer::COLOR_NEVER;
+            if(!fullFormat) printf("#line\tm\tp\tgenerator\tseed\tframe_bits\tflipped\tcrc\trows_corrected\trows_wrong\toutput\n");
+            atomic<size_t> errors{0};
+            size_t cases = RunBatch(in, seed, opt.threads, 4096, stdout, [&](const BatchCase& c){
+                return runBatchCase(c, fullFormat, color, channelSpec, mask, rsParity, errors);
+            });
+            fprintf(stderr, "batch: %zu cases, %zu failed\n", cases, errors.load());
+            return errors ? 1 : 0;
+        }
+        if(fuzz){
+            if(opt.trials == 0 || opt.length == 0){
+                cout << "--fuzz needs positive --trials/--length" << endl;
+                return 1;
+            }
+            uint64_t first = fuzzCase < 0 ? 0 : fuzzCase, count = fuzzCase < 0 ? opt.trials : 1;
+            size_t failures = RunFuzz(seed, first, count, opt.length, stdout);
+            printf("fuzz: %llu cases, %zu failed (seed %llu)\n", (unsigned long long)count, failures,
+                   (unsigned long long)seed);
+            return failures ? 5 : 0;
+        }
+        if(sweep){
+            if(ps.empty() || ms.empty() || gens.empty() || opt.length == 0 || opt.trials == 0){
+                cout << "--sweep needs --p, --m, --gen and positive --trials/--length" << endl;
+                return 1;
+            }
+            vector<SweepPoint> points;
+            for(string& g : gens)
+                for(double m : ms)
+                    for(double p : ps){
+                        if(m < 1 || p < 0 || p > 1) throw invalid_argument("m must be >= 1 and p in [0, 1]");
+                        points.push_back({p, (size_t)m, g});
+                    }
+            opt.seed = seed;
+            opt.channel = Channel::Parse(channelSpec, points[0].p);
+            opt.rsParity = rsParity;
+            vector<CodecMetrics> metrics;
+            vector<SweepCounts> totals = RunSweep(points, opt, metricsFormat ? &metrics : nullptr);
+            if(channelSpec != "iid") printf("#channel\t%s\n", channelSpec.c_str());
+            if(rsParity) printf("#code\trs:%zu\n", rsParity);
+            PrintSweep(points, totals);
+            if(metricsFormat){
+                fflush(stdout);
+                writeMetrics(metricsFormat, metricsFile, points, metrics);
+            }
+            return 0;
+        }
+        if(rare){
+            if(ps.empty() || ms.empty() || gens.empty() || rareOpt.length == 0 || rareOpt.trials == 0
+               || rareOpt.maxWeight == 0 || rareOpt.maxWeight > 63 || channelSpec != "iid" || rsParity){
+                cout << "--rare needs --p, --m, --gen, positive --trials/--length, --weights in 1..63, the iid channel and Hamming rows" << endl;
+                return 1;
+            }
+            vector<pair<size_t, string>> configs;
+            for(string& g : gens)
+                for(double m : ms){
+                    if(m < 1) throw invalid_argument("m must be >= 1");
+                    configs.push_back({(size_t)m, g});
+                }
+            for(double p : ps) if(p < 0 || p > 1) throw invalid_argument("p must be in [0, 1]");
+            rareOpt.seed = seed;
+            PrintRare(RunRare(configs, rareOpt), ps);
+            return 0;
+        }
+        if(stream){
+            double p = ps.empty() ? 0 : ps[0];
+            if(ms.size() != 1 || gens.size() != 1 || ms[0] < 1 || ps.size() > 1 || p < 0 || p > 1){
+                cout << "--stream needs one --m >= 1, one --gen and at most one --p in [0, 1]" << endl;
+                return 1;
+            }
+            Codec codec((size_t)ms[0], gens[0], true, rsParity);
+            Channel channel = Channel::Parse(channelSpec, p);
+            size_t chunk = max<size_t>(chunkBytes / codec.M(), 1) * codec.M(); // only the last frame gets padded
+            ChunkReader in(file, chunk);
+            FILE* out = quiet ? nullptr : stdout;
+            StreamStats s;
+            if(depth){
+                vector<StageStats> stages;
+                auto start = chrono::steady_clock::now();
+                s = RunStreamPipelined(in, codec, channel, seed, out, depth, stages);
+                double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                fflush(stdout);
+                PrintStages(stages, wall);
+            }
+            else s = RunStream(in, codec, channel, seed, out);
+            fflush(stdout);
+            fprintf(stderr, "chunks: %llu  bytes: %llu  flipped bits: %llu  crc rejected: %llu  rows corrected: %llu"
+                            "  bad chunks: %llu\nstream crc: %s %s (%s)\n",
+                    (unsigned long long)s.chunks, (unsigned long long)s.bytes, (unsigned long long)s.bitsFlipped,
+                    (unsigned long long)s.crcRejected, (unsigned long long)s.rowsCorrected,
+                    (unsigned long long)s.badChunks, codec.Crc().ToBits(s.sentCrc).c_str(),
+                    codec.Crc().ToBits(s.receivedCrc).c_str(), s.sentCrc == s.receivedCrc ? "match" : "mismatch");
+            return s.sentCrc == s.receivedCrc ? 0 : 2;
+        }
+    }
+    catch(const exception& e){
+        cout << e.what() << endl;
+        return 1;
+    }
+
+    string data, generator;
+    int m;
+    double p;
+
+    if(!quiet) cout << "enter data string: ";
+    getline(cin, data);
+    if(!quiet) cout << "enter number of data bytes in a row (m): ";
+    cin >> m;
+    if(!quiet) cout << "enter probability (p): ";
+    cin >> p;
+    if(!quiet) cout << "enter generator polynomial: ";
+    cin >> generator;
+
+    if(!cin || data.empty() || m <= 0 || p < 0 || p > 1){
+        cout << "invalid input" << endl;
+        return 1;
+    }
+    try{
+        Codec codec(m, generator, true, rsParity);
+        Channel channel = Channel::Parse(channelSpec, p);
+        vector<CodecMetrics> metrics(1);
+        if(quiet) runStats(data, codec, channel, seed, metricsFormat ? &metrics[0] : nullptr);
+        else{
+            cout.flush(); // the prompts go out before the buffered dump
+            Renderer out(STDOUT_FILENO, color);
+            runCodec(data, codec, channel, seed, out, metricsFormat ? &metrics[0] : nullptr);
+            out.Flush();
+        }
+        if(metricsFormat){
+            fflush(stdout);
+            writeMetrics(metricsFormat, metricsFile, {{p, (size_t)m, generator}}, metrics);
+        }
+    }
+    catch(const exception& e){
+        cout << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include<bits/stdc++.h>
+
+#include "arena.h"
+#include "bitblock.h"
+#include "channel.h"
+#include "codec.h"
+#include "rng.h"
+#include "span_codec.h"
+
+using namespace std;
+
+// build: g++ -O2 -o alloc_check alloc_check.cpp
+// usage: ./alloc_check --m=N --gen=G [--p=P] [--channel=SPEC] [--rs=N] [--length=N] [--trials=N] [--seed=N]
+//                             round trips of up to N bytes (default 4096) through SpanCodec, then one frame
+//                             of over two CrcEngine::kParallelGrain pieces, counting heap allocations after
+//                             the first (largest) frame; exit status 3 if there were any.
+//                             --channel and --rs as in 1905111.cpp
+//
+// The counting allocator below replaces the global one for this program only, so the codec binary
+// keeps the default allocator.
+
+// every heap allocation of the program
+static atomic<uint64_t> heapAllocs{0};
+
+void* operator new(size_t n){
+    heapAllocs.fetch_add(1, memory_order_relaxed);
+    if(void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+
+// kept out of line: an inlined free() next to the out-of-line new trips -Wmismatched-new-delete
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+
+void* operator new[](size_t n){ return operator new(n); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+// sends frames of random length up to length bytes and one large frame through the span API and counts the
+// steady-state allocations
+int allocCheck(const Codec& codec, const Channel& channel, size_t length, size_t frames, uint64_t seed){
+    SpanCodec api(codec);
+    // large enough that a plain Codec::Checksum would split it across a thread pool
+    size_t large = 2 * CrcEngine::kParallelGrain / 8 + codec.M();
+    size_t largest = max(length, large);
+    vector<char> message(largest), decoded(api.DecodedBytes(api.FrameBits(largest)));
+    vector<uint64_t> frame(api.FrameWords(largest));
+    Philox4x32 rng(seed, 0);
+    auto roundTrip = [&](size_t len, uint64_t index){
+        for(size_t i = 0; i < len; i++) message[i] = (char)(32 + rng() % 95);
+        size_t nbits = api.Encode(Span<const char>(message.data(), len), frame);
+        BitSpan bits(frame.data(), nbits);
+        Philox4x32 noise(seed, index);
+        channel.Apply(bits, noise);
+        ReceiveResult rx = api.Decode(frame, nbits, decoded);
+        return rx.crcOk && memcmp(message.data(), decoded.data(), len) == 0;
+    };
+    roundTrip(largest, 1); // the largest frame sizes every buffer and the arena
+    uint64_t before = heapAllocs.load();
+    size_t clean = 0;
+    for(size_t i = 0; i < frames; i++) clean += roundTrip(1 + rng() % length, i + 2);
+    clean += roundTrip(large, frames + 2);
+    uint64_t allocs = heapAllocs.load() - before;
+    const char* kernel = codec.GetReedSolomon() ? "reed-solomon" : codec.Specialized() ? "fixed" : "generic";
+    printf("frames: %zu + 1  length: 1..%zu, %zu  kernel: %s  clean: %zu  arena: %zu words  heap allocations: %llu\n",
+           frames, length, large, kernel, clean, FrameArena::ForThread().Capacity(), (unsigned long long)allocs);
+    return allocs ? 3 : 0;
+}
+
+int main(int argc, char* argv[]){
+    uint64_t seed = ((uint64_t)random_device{}() << 32) | random_device{}();
+    size_t m = 0, rsParity = 0, length = 4096, trials = 1000;
+    double p = 0;
+    string generator, channelSpec = "iid";
+    try{
+        for(int i = 1; i < argc; i++){
+            string arg = argv[i];
+            string value = arg.substr(arg.find('=') + 1);
+            if(arg.rfind("--m=", 0) == 0) m = stoull(value);
+            else if(arg.rfind("--gen=", 0) == 0) generator = value;
+            else if(arg.rfind("--p=", 0) == 0) p = stod(value);
+            else if(arg.rfind("--channel=", 0) == 0) channelSpec = value;
+            else if(arg.rfind("--rs=", 0) == 0) rsParity = stoull(value);
+            else if(arg.rfind("--length=", 0) == 0) length = stoull(value);
+            else if(arg.rfind("--trials=", 0) == 0) trials = stoull(value);
+            else if(arg.rfind("--seed=", 0) == 0) seed = stoull(value);
+            else{
+                cout << "unknown option " << arg << endl;
+                return 1;
+            }
+        }
+        if(m < 1 || generator.empty() || p < 0 || p > 1 || length == 0 || trials == 0){
+            cout << "alloc_check needs --m >= 1, --gen, --p in [0, 1] and positive --trials/--length" << endl;
+            return 1;
+        }
+        return allocCheck(Codec(m, generator, true, rsParity), Channel::Parse(channelSpec, p), length, trials, seed);
+    }
+    catch(const exception& e){
+        cout << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,151 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * \brief Per-thread bump allocator for the scratch words of the codec kernels.
+ *
+ * Memory comes in blocks that are kept until the thread ends: Rewind and
+ * Reset only move the fill mark back. Once a thread has seen its largest
+ * frame, every later frame is served from blocks it already has and the
+ * kernels run without touching the heap.
+ * Allocations are released in LIFO order, normally through ArenaScope.
+ */
+class FrameArena
+{
+  public:
+    /// Position of the fill mark, see Save and Rewind.
+    struct Mark
+    {
+        size_t block;
+        size_t used;
+    };
+
+    /// Smallest block, in words.
+    static const size_t kMinBlockWords = 4096;
+
+    FrameArena()
+        : m_block(0),
+          m_used(0)
+    {
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /// The calling thread's arena.
+    static FrameArena& ForThread()
+    {
+        thread_local FrameArena arena;
+        return arena;
+    }
+
+    /// \p n uninitialized words; requests are rounded up to whole cache lines.
+    uint64_t* Words(size_t n)
+    {
+        n = (n + 7) & ~size_t(7);
+        while (m_block < m_blocks.size())
+        {
+            if (m_blocks[m_block].size - m_used >= n)
+            {
+                uint64_t* p = m_blocks[m_block].words.get() + m_used;
+                m_used += n;
+                return p;
+            }
+            m_block++;
+            m_used = 0;
+        }
+        size_t size = m_blocks.empty() ? kMinBlockWords : 2 * m_blocks.back().size;
+        while (size < n)
+        {
+            size *= 2;
+        }
+        m_blocks.push_back(Block{std::unique_ptr<uint64_t[]>(new uint64_t[size]), size});
+        m_block = m_blocks.size() - 1;
+        m_used = n;
+        return m_blocks.back().words.get();
+    }
+
+    /// \p n zeroed words.
+    uint64_t* ZeroWords(size_t n)
+    {
+        uint64_t* p = Words(n);
+        std::fill(p, p + n, 0);
+        return p;
+    }
+
+    Mark Save() const
+    {
+        return Mark{m_block, m_used};
+    }
+
+    /// Release everything handed out since \p mark was saved.
+    void Rewind(Mark mark)
+    {
+        m_block = mark.block;
+        m_used = mark.used;
+    }
+
+    /// Release everything, e.g. between two frames.
+    void Reset()
+    {
+        Rewind(Mark{0, 0});
+    }
+
+    /// Words held in all blocks.
+    size_t Capacity() const
+    {
+        size_t c = 0;
+        for (const Block& b : m_blocks)
+        {
+            c += b.size;
+        }
+        return c;
+    }
+
+  private:
+    struct Block
+    {
+        std::unique_ptr<uint64_t[]> words;
+        size_t size; //!< Words in the block.
+    };
+
+    std::vector<Block> m_blocks; //!< Never shrinks.
+    size_t m_block;              //!< Block the next words come from.
+    size_t m_used;               //!< Words of that block handed out.
+};
+
+/// Gives back on destruction whatever was taken from the arena in its lifetime.
+class ArenaScope
+{
+  public:
+    explicit ArenaScope(FrameArena& arena = FrameArena::ForThread())
+        : m_arena(arena),
+          m_mark(arena.Save())
+    {
+    }
+
+    ~ArenaScope()
+    {
+        m_arena.Rewind(m_mark);
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    FrameArena& Arena() const
+    {
+        return m_arena;
+    }
+
+  private:
+    FrameArena& m_arena;
+    FrameArena::Mark m_mark;
+};
+
+#endif /* ARENA_H */
@@ -0,0 +1,134 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "parallel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// One line of a batch file: the four interactive inputs and the channel seed.
+struct BatchCase
+{
+    size_t line = 0;       //!< Line number in the input, from 1.
+    std::string data;
+    size_t m = 0;
+    double p = 0;
+    std::string generator;
+    uint64_t seed = 0;
+    std::string error;     //!< Why the line could not be read; empty if it could.
+};
+
+/**
+ * \brief Parse "data TAB m TAB p TAB generator [TAB seed]".
+ *
+ * The data string is everything before the first tab, spaces included.
+ * Without a seed column the case gets \p defaultSeed. A malformed line
+ * is returned with \c error set instead of throwing, so that one bad case
+ * does not stop a corpus.
+ */
+inline BatchCase
+ParseBatchCase(const std::string& text, size_t line, uint64_t defaultSeed)
+{
+    BatchCase c;
+    c.line = line;
+    c.seed = defaultSeed;
+    std::vector<std::string> fields;
+    std::stringstream ss(text);
+    for (std::string f; std::getline(ss, f, '\t');)
+    {
+        fields.push_back(f);
+    }
+    if (fields.size() < 4 || fields.size() > 5 || fields[0].empty())
+    {
+        c.error = "expected data, m, p, generator and an optional seed, separated by tabs";
+        return c;
+    }
+    try
+    {
+        size_t used;
+        long long m = std::stoll(fields[1], &used);
+        if (used != fields[1].size() || m <= 0)
+        {
+            throw std::invalid_argument("m");
+        }
+        c.p = std::stod(fields[2], &used);
+        if (used != fields[2].size() || !(c.p >= 0 && c.p <= 1))
+        {
+            throw std::invalid_argument("p");
+        }
+        if (fields.size() == 5)
+        {
+            c.seed = std::stoull(fields[4], &used);
+            if (used != fields[4].size())
+            {
+                throw std::invalid_argument("seed");
+            }
+        }
+        c.m = (size_t)m;
+    }
+    catch (const std::exception&)
+    {
+        c.error = "bad number: m must be >= 1, p in [0, 1] and the seed an unsigned integer";
+        return c;
+    }
+    c.data = fields[0];
+    c.generator = fields[3];
+    return c;
+}
+
+/**
+ * \brief Run every case of \p in through \p fn on \p threads threads, writing the results in input order.
+ *
+ * Cases are read \p window at a time; a window is processed in parallel
+ * and written out before the next one is read, so memory stays bounded
+ * for any corpus size and the first results appear early. Empty lines
+ * and lines starting with '#' are skipped. Case i without a seed column
+ * is seeded with \p seed + i.
+ * \param fn string fn(const BatchCase&), the text to write for a case.
+ * \return number of cases.
+ */
+template <typename Fn>
+size_t
+RunBatch(std::istream& in, uint64_t seed, size_t threads, size_t window, FILE* out, Fn fn)
+{
+    size_t count = 0;
+    size_t line = 0;
+    std::vector<BatchCase> cases;
+    std::vector<std::string> results;
+    bool more = true;
+    while (more)
+    {
+        cases.clear();
+        std::string text;
+        while (cases.size() < window && (more = (bool)std::getline(in, text)))
+        {
+            line++;
+            if (!text.empty() && text.back() == '\r')
+            {
+                text.pop_back();
+            }
+            if (text.empty() || text[0] == '#')
+            {
+                continue;
+            }
+            cases.push_back(ParseBatchCase(text, line, seed + count + cases.size()));
+        }
+        results.assign(cases.size(), std::string());
+        ParallelFor(cases.size(), threads, [&](size_t i) { results[i] = fn(cases[i]); });
+        for (const std::string& r : results)
+        {
+            std::fwrite(r.data(), 1, r.size(), out);
+        }
+        std::fflush(out);
+        count += cases.size();
+    }
+    return count;
+}
+
+#endif /* BATCH_H */
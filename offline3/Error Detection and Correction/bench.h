@@ -0,0 +1,295 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "bitblock.h"
+#include "codec.h"
+#include "crc.h"
+#include "hamming.h"
+#include "transpose.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Seconds per call of \p fn, repeated until at least \p minSeconds have passed.
+ */
+template <typename Fn>
+double
+BenchSeconds(Fn fn, double minSeconds = 0.05)
+{
+    using Clock = std::chrono::steady_clock;
+    size_t iters = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    do
+    {
+        fn();
+        iters++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    return elapsed / iters;
+}
+
+/// Bit-by-bit column-major gather, the baseline the transpose kernels replace.
+inline void
+TransposeBitsNaive(const BitVec& in, size_t rows, size_t cols, BitVec& out)
+{
+    out.Resize(rows * cols);
+    for (size_t c = 0, i = 0; c < cols; c++)
+    {
+        for (size_t r = 0; r < rows; r++, i++)
+        {
+            out.Set(i, in.Get(r * cols + c));
+        }
+    }
+}
+
+/**
+ * \brief Serialization / de-serialization throughput against row count and m.
+ *
+ * Blocks are rows x (8m + r) Hamming codewords of random bits. Prints one
+ * line per (rows, m, kernel) with both directions in Mbit/s.
+ */
+inline void
+BenchTranspose()
+{
+    std::mt19937_64 rng(1);
+    std::vector<Transpose64Fn> kernels = {Transpose64Scalar};
+#ifdef TRANSPOSE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        kernels.push_back(Transpose64Sse2);
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        kernels.push_back(Transpose64Avx2);
+    }
+#endif
+    std::printf("%-8s %-4s %-6s %-8s %14s %14s\n", "rows", "m", "cols", "kernel", "serialize", "deserialize");
+    for (size_t rows : {64, 1024, 16384, 131072})
+    {
+        for (size_t m : {1, 2, 4, 8, 16, 64})
+        {
+            size_t cols = Hamming(8 * m).CodeBits();
+            BitVec block(rows * cols);
+            for (size_t i = 0; i < block.NumWords(); i++)
+            {
+                block.Words()[i] = rng();
+            }
+            block.ClearTail();
+            BitVec serial;
+            BitVec back;
+            double mbits = rows * cols / 1e6;
+
+            double ser = BenchSeconds([&] { TransposeBitsNaive(block, rows, cols, serial); });
+            double des = BenchSeconds([&] { TransposeBitsNaive(serial, cols, rows, back); });
+            std::printf("%-8zu %-4zu %-6zu %-8s %9.1f Mb/s %9.1f Mb/s\n", rows, m, cols, "naive", mbits / ser, mbits / des);
+            for (Transpose64Fn k : kernels)
+            {
+                ser = BenchSeconds([&] { TransposeBits(block, rows, cols, serial, k); });
+                des = BenchSeconds([&] { TransposeBits(serial, cols, rows, back, k); });
+                std::printf("%-8zu %-4zu %-6zu %-8s %9.1f Mb/s %9.1f Mb/s\n",
+                            rows, m, cols, Transpose64Name(k), mbits / ser, mbits / des);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Hamming encode / correct throughput, row by row against bitsliced.
+ *
+ * Correction runs on blocks with one flipped bit in every 100th row, the
+ * regime of the Monte-Carlo error-rate runs. Rates are data Mbit/s.
+ */
+inline void
+BenchHamming()
+{
+    std::mt19937_64 rng(2);
+    size_t rows = 65536;
+    std::printf("%-4s %-6s %-10s %14s %14s\n", "m", "cols", "mode", "encode", "correct");
+    for (size_t m : {1, 2, 4, 8, 16, 64})
+    {
+        Hamming h(8 * m);
+        BitBlock data(rows, 8 * m);
+        for (size_t i = 0; i < data.Bits().NumWords(); i++)
+        {
+            data.Bits().Words()[i] = rng();
+        }
+        data.Bits().ClearTail();
+        BitBlock code = h.Encode(data);
+        BitBlock noisy = code;
+        for (size_t r = 0; r < rows; r += 100)
+        {
+            noisy.Bits().Flip(r * h.CodeBits() + rng() % h.CodeBits());
+        }
+        BitBlock work;
+        double mbits = rows * 8 * m / 1e6;
+
+        double enc = BenchSeconds([&] {
+            for (size_t r = 0; r < rows; r++)
+            {
+                h.EncodeRow(data.Bits(), r * h.DataBits(), code.Bits(), r * h.CodeBits());
+            }
+        });
+        double cor = BenchSeconds([&] {
+            work = noisy;
+            for (size_t r = 0; r < rows; r++)
+            {
+                h.CorrectRow(work.Bits(), r * h.CodeBits());
+            }
+        });
+        std::printf("%-4zu %-6zu %-10s %9.1f Mb/s %9.1f Mb/s\n", m, h.CodeBits(), "rows", mbits / enc, mbits / cor);
+
+        enc = BenchSeconds([&] { h.EncodeSliced<1>(data, code); });
+        cor = BenchSeconds([&] {
+            work = noisy;
+            h.CorrectSliced<1>(work);
+        });
+        std::printf("%-4zu %-6zu %-10s %9.1f Mb/s %9.1f Mb/s\n", m, h.CodeBits(), "sliced64", mbits / enc, mbits / cor);
+
+        if (CpuHasAvx2())
+        {
+            enc = BenchSeconds([&] { code = h.Encode(data); });
+            cor = BenchSeconds([&] {
+                work = noisy;
+                h.Correct(work);
+            });
+            std::printf("%-4zu %-6zu %-10s %9.1f Mb/s %9.1f Mb/s\n", m, h.CodeBits(), "sliced256", mbits / enc, mbits / cor);
+        }
+    }
+}
+
+/**
+ * \brief CRC throughput of one large frame, sequential against split and combined.
+ *
+ * The frame is 512 Mbit of random words; the parallel rows cut it into
+ * CrcEngine::kParallelGrain pieces and merge them with Combine.
+ */
+inline void
+BenchCrc()
+{
+    std::mt19937_64 rng(3);
+    size_t nbits = size_t(1) << 29;
+    std::vector<uint64_t> words(nbits / 64);
+    for (uint64_t& w : words)
+    {
+        w = rng();
+    }
+    std::vector<size_t> threads = {1, 2, 4};
+    size_t hw = std::thread::hardware_concurrency();
+    if (hw > 4)
+    {
+        threads.push_back(hw);
+    }
+    volatile uint64_t sink; // keeps the unused checksums from being optimized away
+    std::printf("%-10s %-8s %14s\n", "crc", "threads", "rate");
+    for (const char* gen : {"10001000000100001", "100000100110000010001110110110111"})
+    {
+        CrcEngine crc(gen);
+        double mbits = nbits / 1e6;
+        double t = BenchSeconds([&] { sink = crc.ComputeWords(words.data(), nbits); });
+        std::printf("crc-%-6u %-8s %9.1f Mb/s\n", crc.Degree(), "serial", mbits / t);
+        for (size_t n : threads)
+        {
+            t = BenchSeconds([&] { sink = crc.ComputeWordsParallel(words.data(), nbits, n); });
+            std::printf("crc-%-6u %-8zu %9.1f Mb/s\n", crc.Degree(), n, mbits / t);
+        }
+    }
+}
+
+/**
+ * \brief Generic engines against the compile-time kernels, per stage.
+ *
+ * Same blocks as BenchHamming: 65536 random rows, one flipped bit in
+ * every 100th row for the correction. Rates are data Mbit/s.
+ */
+inline void
+BenchFixedKernels()
+{
+    std::mt19937_64 rng(4);
+    size_t rows = 65536;
+    std::printf("%-4s %-6s %-9s %14s %14s %14s\n", "m", "crc", "engine", "encode", "correct", "checksum");
+    for (size_t m : {1, 2, 4, 8})
+    {
+        for (const char* gen : {"100000111", "10001000000100001", "100000100110000010001110110110111"})
+        {
+            for (bool specialize : {false, true})
+            {
+                Codec codec(m, gen, specialize);
+                BitBlock data(rows, 8 * m);
+                for (size_t i = 0; i < data.Bits().NumWords(); i++)
+                {
+                    data.Bits().Words()[i] = rng();
+                }
+                data.Bits().ClearTail();
+                BitBlock code = codec.AddCheckBits(data);
+                BitBlock noisy = code;
+                size_t n = code.Cols();
+                for (size_t r = 0; r < rows; r += 100)
+                {
+                    noisy.Bits().Flip(r * n + rng() % n);
+                }
+                BitBlock work;
+                volatile uint64_t sink;
+                double mbits = rows * 8 * m / 1e6;
+                double enc = BenchSeconds([&] { code = codec.AddCheckBits(data); });
+                double cor = BenchSeconds([&] {
+                    work = noisy;
+                    codec.CorrectRows(work);
+                });
+                double crc = BenchSeconds([&] { sink = codec.Checksum(code.Bits(), code.Bits().Size()); });
+                std::printf("%-4zu crc-%-2u %-9s %9.1f Mb/s %9.1f Mb/s %9.1f Mb/s\n", m, codec.Crc().Degree(),
+                            specialize ? "fixed" : "generic", mbits / enc, mbits / cor, mbits / crc);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Receive latency per frame, the chain of receiver stages against Codec::Receive.
+ *
+ * Frames carry random data with CRC-32 and one flipped bit in every
+ * 100th row.
+ */
+inline void
+BenchReceive()
+{
+    std::mt19937_64 rng(5);
+    std::printf("%-8s %-4s %-8s %12s %14s\n", "rows", "m", "path", "latency", "rate");
+    for (size_t rows : {16, 256, 4096, 65536})
+    {
+        for (size_t m : {1, 4, 8})
+        {
+            Codec codec(m, "100000100110000010001110110110111");
+            std::string data(rows * m, '\0');
+            for (char& ch : data)
+            {
+                ch = (char)rng();
+            }
+            BitVec frame = codec.AppendCrc(codec.Serialize(codec.AddCheckBits(codec.DataBlock(data))));
+            size_t n = codec.GetHamming().CodeBits();
+            for (size_t r = 0; r < rows; r += 100)
+            {
+                frame.Flip((rng() % n) * rows + r);
+            }
+            std::string out(rows * m, '\0');
+            volatile bool sink;
+            double mbits = frame.Size() / 1e6;
+            double chain = BenchSeconds([&] {
+                sink = codec.CheckCrc(frame);
+                BitBlock block = codec.Deserialize(frame);
+                codec.CorrectRows(block);
+                out = Codec::Ascii(codec.RemoveCheckBits(block));
+            });
+            double fused = BenchSeconds([&] { sink = codec.Receive(frame, &out[0]).crcOk; });
+            std::printf("%-8zu %-4zu %-8s %9.2f us %9.1f Mb/s\n", rows, m, "chain", chain * 1e6, mbits / chain);
+            std::printf("%-8zu %-4zu %-8s %9.2f us %9.1f Mb/s\n", rows, m, "fused", fused * 1e6, mbits / fused);
+        }
+    }
+}
+
+#endif /* BENCH_H */
@@ -0,0 +1,349 @@
+#ifndef BENCH_SUITE_H
+#define BENCH_SUITE_H
+
+#include "bitblock.h"
+#include "channel.h"
+#include "codec.h"
+#include "rng.h"
+#include "span_codec.h"
+#include "transpose.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// What the benchmark suite sweeps.
+struct BenchSuiteOptions
+{
+    std::vector<size_t> sizes = {1 << 10, 1 << 15, 1 << 20, 1 << 25}; //!< Message bytes.
+    std::vector<size_t> ms = {1, 4, 8};                                //!< Row widths.
+    std::vector<double> ps = {0, 1e-4, 1e-2};                          //!< Channel error probabilities.
+    std::vector<std::string> generators = {
+        "10001001",                          // CRC-7, generic engine only
+        "100000111",                         // CRC-8
+        "10001000000100001",                 // CRC-16-CCITT
+        "100000100110000010001110110110111", // CRC-32
+    };
+    std::vector<size_t> rsParity = {4, 16}; //!< Reed-Solomon parity bytes measured next to Hamming.
+    double minSeconds = 0.1;                //!< Time per measurement.
+};
+
+/// One measurement: a kernel on one message size and configuration.
+struct BenchRecord
+{
+    std::string kernel;  //!< e.g. "crc", "encode", "roundtrip".
+    std::string variant; //!< Configuration within the kernel, e.g. "crc-16" or "-".
+    size_t bytes = 0;    //!< Message size.
+    size_t m = 0;        //!< Row width, 0 where it does not apply.
+    double p = 0;        //!< Error probability, 0 where it does not apply.
+    double seconds = 0;  //!< Per call.
+    double bitsPerSecond = 0;
+    double cyclesPerBit = NAN; //!< Time-stamp counter cycles per message bit; NAN off x86.
+
+    /// Identity of the measurement across runs.
+    std::string Key() const
+    {
+        std::ostringstream s;
+        s << kernel << ' ' << variant << ' ' << bytes << ' ' << m << ' ' << p;
+        return s.str();
+    }
+};
+
+/// Row codes to measure for width \p m: 0 (Hamming), then every Reed-Solomon parity that fits.
+inline std::vector<size_t>
+BenchRowCodes(const BenchSuiteOptions& opt, size_t m)
+{
+    std::vector<size_t> codes(1, 0);
+    for (size_t parity : opt.rsParity)
+    {
+        if (parity && m + parity <= 255)
+        {
+            codes.push_back(parity);
+        }
+    }
+    return codes;
+}
+
+/// Variant name of a codec's row code: "fixed" or "generic" Hamming, or "rs-N".
+inline std::string
+BenchRowVariant(const Codec& codec)
+{
+    if (const ReedSolomon* rs = codec.GetReedSolomon())
+    {
+        return "rs-" + std::to_string(rs->ParityBytes());
+    }
+    return codec.Specialized() ? "fixed" : "generic";
+}
+
+/// Time-stamp counter, or 0 where there is none.
+inline uint64_t
+CycleCount()
+{
+#ifdef TRANSPOSE_X86
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * \brief Time \p fn for about \p minSeconds after one warm-up call.
+ *
+ * Fills the seconds, rate and cycles of \p rec; \p bits is the message
+ * size the rates refer to. The time-stamp counter ticks at a constant
+ * reference rate, not the core clock, so cycles per bit compare across
+ * runs on one machine rather than across machines.
+ */
+template <typename Fn>
+void
+BenchMeasure(BenchRecord& rec, double bits, double minSeconds, Fn fn)
+{
+    using Clock = std::chrono::steady_clock;
+    fn();
+    size_t iters = 0;
+    uint64_t c0 = CycleCount();
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    do
+    {
+        fn();
+        iters++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    uint64_t c1 = CycleCount();
+    rec.seconds = elapsed / iters;
+    rec.bitsPerSecond = bits / rec.seconds;
+    rec.cyclesPerBit = c1 ? (double)(c1 - c0) / iters / bits : NAN;
+}
+
+/**
+ * \brief Every kernel over every size of \p opt: CRC per generator, Hamming
+ * and Reed-Solomon encode and correct and the column transpose per m, the i.i.d. and burst
+ * channels per p > 0 (burst models only up to p = 0.5), and the whole round
+ * trip (SpanCodec encode, channel, fused receive) per (m, p).
+ *
+ * Inputs are random. Correction runs on blocks with one flipped bit in
+ * every 100th row; the same bits are flipped back in after every call, so
+ * each call corrects the same errors. \p progress, if set, gets every
+ * record as soon as it is measured.
+ */
+inline std::vector<BenchRecord>
+RunBenchSuite(const BenchSuiteOptions& opt, FILE* progress = nullptr)
+{
+    std::vector<BenchRecord> records;
+    std::mt19937_64 rng(6);
+    auto add = [&](const BenchRecord& rec) {
+        records.push_back(rec);
+        if (progress)
+        {
+            std::fprintf(progress, "%-10s %-8s %12zu %4zu %-8g %10.1f Mb/s %8.3f cycles/bit\n", rec.kernel.c_str(),
+                         rec.variant.c_str(), rec.bytes, rec.m, rec.p, rec.bitsPerSecond / 1e6, rec.cyclesPerBit);
+            std::fflush(progress);
+        }
+    };
+    volatile uint64_t sink; // keeps results that are not otherwise used alive
+
+    for (size_t bytes : opt.sizes)
+    {
+        double bits = 8.0 * bytes;
+        std::string message(bytes, '\0');
+        for (char& ch : message)
+        {
+            ch = (char)rng();
+        }
+        BitVec raw = BitVec::FromBytes(message);
+
+        for (const std::string& gen : opt.generators)
+        {
+            Codec codec(1, gen);
+            BenchRecord rec{"crc", "crc-" + std::to_string(codec.Crc().Degree()), bytes};
+            BenchMeasure(rec, bits, opt.minSeconds, [&] { sink = codec.Checksum(raw, raw.Size()); });
+            add(rec);
+        }
+
+        for (size_t m : opt.ms)
+        {
+            for (size_t parity : BenchRowCodes(opt, m))
+            {
+                Codec codec(m, opt.generators.back(), true, parity);
+                BitBlock data;
+                codec.DataBlock(message.data(), bytes, data);
+                BitBlock code;
+                BenchRecord rec{"encode", BenchRowVariant(codec), bytes, m};
+                BenchMeasure(rec, bits, opt.minSeconds, [&] { codec.AddCheckBits(data, code); });
+                add(rec);
+
+                size_t n = code.Cols();
+                std::vector<size_t> flips;
+                for (size_t r = 0; r < code.Rows(); r += 100)
+                {
+                    flips.push_back(r * n + rng() % n);
+                }
+                auto inject = [&] {
+                    for (size_t pos : flips)
+                    {
+                        code.Bits().Flip(pos);
+                    }
+                };
+                inject();
+                rec = BenchRecord{"correct", rec.variant, bytes, m};
+                BenchMeasure(rec, bits, opt.minSeconds, [&] {
+                    sink = codec.CorrectRows(code);
+                    inject();
+                });
+                add(rec);
+                inject();
+
+                if (parity == 0)
+                {
+                    BitVec serial;
+                    rec = BenchRecord{"transpose", Transpose64Name(Transpose64Best()), bytes, m};
+                    BenchMeasure(rec, bits, opt.minSeconds, [&] { codec.Serialize(code, serial); });
+                    add(rec);
+                }
+            }
+        }
+
+        for (double p : opt.ps)
+        {
+            if (p == 0)
+            {
+                continue; // nothing to time, Apply returns at once
+            }
+            // "-" is the i.i.d. channel; the burst models should cost about the same
+            for (const char* spec : {"-", "ge:16", "burst:16"})
+            {
+                if (spec[0] != '-' && p > 0.5)
+                {
+                    continue;
+                }
+                Channel channel = spec[0] == '-' ? Channel(p) : Channel::Parse(spec, p);
+                BitVec frame = raw;
+                uint64_t stream = 0;
+                BenchRecord rec{"channel", spec, bytes, 0, p};
+                BenchMeasure(rec, bits, opt.minSeconds, [&] {
+                    Philox4x32 noise(1, stream++);
+                    sink = channel.Apply(frame, noise);
+                });
+                add(rec);
+            }
+        }
+
+        for (size_t m : opt.ms)
+        {
+            for (size_t parity : BenchRowCodes(opt, m))
+            {
+                Codec codec(m, opt.generators.back(), true, parity);
+                SpanCodec api(codec);
+                std::vector<uint64_t> frame(api.FrameWords(bytes));
+                std::vector<char> decoded(api.DecodedBytes(api.FrameBits(bytes)));
+                for (double p : opt.ps)
+                {
+                    BitFlipChannel channel(p);
+                    uint64_t stream = 0;
+                    BenchRecord rec{"roundtrip", BenchRowVariant(codec), bytes, m, p};
+                    BenchMeasure(rec, bits, opt.minSeconds, [&] {
+                        size_t nbits = api.Encode(Span<const char>(message.data(), bytes), frame);
+                        BitSpan view(frame.data(), nbits);
+                        Philox4x32 noise(1, stream++);
+                        channel.Apply(view, noise);
+                        sink = api.Decode(frame, nbits, decoded).rowsCorrected;
+                    });
+                    add(rec);
+                }
+            }
+        }
+    }
+    return records;
+}
+
+/// Tab-separated records under a '#' header line.
+inline void
+WriteBenchRecords(FILE* out, const std::vector<BenchRecord>& records)
+{
+    std::fprintf(out, "#kernel\tvariant\tbytes\tm\tp\tseconds\tbits_per_s\tcycles_per_bit\n");
+    for (const BenchRecord& r : records)
+    {
+        std::fprintf(out, "%s\t%s\t%zu\t%zu\t%g\t%.6g\t%.6g\t%.6g\n", r.kernel.c_str(), r.variant.c_str(), r.bytes,
+                     r.m, r.p, r.seconds, r.bitsPerSecond, r.cyclesPerBit);
+    }
+}
+
+/// Records written by WriteBenchRecords, keyed by BenchRecord::Key.
+inline std::map<std::string, BenchRecord>
+ReadBenchRecords(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::map<std::string, BenchRecord> records;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::istringstream s(line);
+        BenchRecord r;
+        std::string cycles;
+        if (!(s >> r.kernel >> r.variant >> r.bytes >> r.m >> r.p >> r.seconds >> r.bitsPerSecond >> cycles))
+        {
+            throw std::runtime_error("bad benchmark record in " + path + ": " + line);
+        }
+        r.cyclesPerBit = std::strtod(cycles.c_str(), nullptr);
+        records[r.Key()] = r;
+    }
+    return records;
+}
+
+/**
+ * \brief Compare \p current against \p baseline and report every shared measurement.
+ *
+ * A measurement regresses when its throughput fell by more than
+ * \p tolerance (0.2 = 20%). Measurements missing on either side are
+ * listed but do not fail the comparison.
+ * \return number of regressions.
+ */
+inline size_t
+CompareBench(const std::vector<BenchRecord>& current, const std::map<std::string, BenchRecord>& baseline,
+             double tolerance, FILE* out)
+{
+    size_t regressions = 0;
+    size_t matched = 0;
+    std::fprintf(out, "%-10s %-8s %12s %4s %-8s %12s %12s %8s\n", "kernel", "variant", "bytes", "m", "p", "baseline",
+                 "current", "change");
+    for (const BenchRecord& r : current)
+    {
+        auto it = baseline.find(r.Key());
+        if (it == baseline.end())
+        {
+            std::fprintf(out, "%-10s %-8s %12zu %4zu %-8g %12s %7.1f Mb/s %8s\n", r.kernel.c_str(), r.variant.c_str(),
+                         r.bytes, r.m, r.p, "-", r.bitsPerSecond / 1e6, "new");
+            continue;
+        }
+        matched++;
+        double change = r.bitsPerSecond / it->second.bitsPerSecond - 1;
+        bool slow = change < -tolerance;
+        regressions += slow;
+        std::fprintf(out, "%-10s %-8s %12zu %4zu %-8g %7.1f Mb/s %7.1f Mb/s %+7.1f%%%s\n", r.kernel.c_str(),
+                     r.variant.c_str(), r.bytes, r.m, r.p, it->second.bitsPerSecond / 1e6, r.bitsPerSecond / 1e6,
+                     100 * change, slow ? "  REGRESSION" : "");
+    }
+    std::fprintf(out, "%zu of %zu measurements compared, %zu slower than the baseline by more than %.0f%%\n", matched,
+                 current.size(), regressions, 100 * tolerance);
+    return regressions;
+}
+
+#endif /* BENCH_SUITE_H */
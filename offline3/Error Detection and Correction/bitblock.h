@@ -0,0 +1,549 @@
+#ifndef BITBLOCK_H
+#define BITBLOCK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Growable bit string packed MSB first into 64-bit words.
+ *
+ * Bit i of the string lives in word i / 64 at bit 63 - i % 64, so the
+ * words read left to right in the same order as the printed '0'/'1'
+ * string and can be handed to the CRC engine as they are. Bits past
+ * \c Size() in the last word are always zero.
+ */
+class BitVec
+{
+  public:
+    BitVec()
+        : m_size(0)
+    {
+    }
+
+    /// \param nbits initial length, all bits zero.
+    explicit BitVec(size_t nbits)
+        : m_words(WordCount(nbits), 0),
+          m_size(nbits)
+    {
+    }
+
+    /// Parse a '0'/'1' string; any other character reads as 0.
+    static BitVec FromString(const std::string& bits)
+    {
+        BitVec v(bits.size());
+        for (size_t i = 0; i < bits.size(); i++)
+        {
+            if (bits[i] == '1')
+            {
+                v.Set(i, true);
+            }
+        }
+        return v;
+    }
+
+    /// Pack the 8-bit codes of \p bytes, first byte first.
+    static BitVec FromBytes(const std::string& bytes)
+    {
+        BitVec v(bytes.size() * 8);
+        size_t i = 0;
+        for (; i + 8 <= bytes.size(); i += 8)
+        {
+            uint64_t w = 0;
+            for (int k = 0; k < 8; k++)
+            {
+                w = (w << 8) | (unsigned char)bytes[i + k];
+            }
+            v.m_words[i / 8] = w;
+        }
+        for (; i < bytes.size(); i++)
+        {
+            v.SetBits(i * 8, 8, (unsigned char)bytes[i]);
+        }
+        return v;
+    }
+
+    /// Number of valid bits.
+    size_t Size() const
+    {
+        return m_size;
+    }
+
+    /// Number of words backing the bits.
+    size_t NumWords() const
+    {
+        return m_words.size();
+    }
+
+    uint64_t* Words()
+    {
+        return m_words.data();
+    }
+
+    const uint64_t* Words() const
+    {
+        return m_words.data();
+    }
+
+    /// Change the length; new bits are zero.
+    void Resize(size_t nbits)
+    {
+        m_words.resize(WordCount(nbits), 0);
+        m_size = nbits;
+        ClearTail();
+    }
+
+    bool Get(size_t i) const
+    {
+        return (m_words[i >> 6] >> (63 - (i & 63))) & 1;
+    }
+
+    void Set(size_t i, bool b)
+    {
+        uint64_t mask = 1ULL << (63 - (i & 63));
+        m_words[i >> 6] = b ? m_words[i >> 6] | mask : m_words[i >> 6] & ~mask;
+    }
+
+    void Flip(size_t i)
+    {
+        m_words[i >> 6] ^= 1ULL << (63 - (i & 63));
+    }
+
+    /**
+     * \brief Read \p n bits starting at \p pos.
+     * \param n 1..64 bits, must not run past \c Size().
+     * \return the bits right-aligned, the bit at \p pos being the most significant.
+     */
+    uint64_t GetBits(size_t pos, unsigned n) const
+    {
+        return GetBits(m_words.data(), pos, n);
+    }
+
+    /// Overwrite \p n bits (1..64) starting at \p pos with the low \p n bits of \p v.
+    void SetBits(size_t pos, unsigned n, uint64_t v)
+    {
+        XorBits(pos, n, GetBits(pos, n) ^ v);
+    }
+
+    /// XOR the low \p n bits (1..64) of \p v into the bits starting at \p pos.
+    void XorBits(size_t pos, unsigned n, uint64_t v)
+    {
+        XorBits(m_words.data(), pos, n, v);
+    }
+
+    /// \copydoc GetBits, on bare words packed like a BitVec.
+    static uint64_t GetBits(const uint64_t* words, size_t pos, unsigned n)
+    {
+        size_t w = pos >> 6;
+        unsigned off = pos & 63;
+        uint64_t hi = words[w] << off;
+        if (off + n > 64)
+        {
+            hi |= words[w + 1] >> (64 - off);
+        }
+        return hi >> (64 - n);
+    }
+
+    /// \copydoc XorBits, on bare words packed like a BitVec.
+    static void XorBits(uint64_t* words, size_t pos, unsigned n, uint64_t v)
+    {
+        if (n < 64)
+        {
+            v &= (1ULL << n) - 1;
+        }
+        size_t w = pos >> 6;
+        unsigned off = pos & 63;
+        unsigned end = off + n;
+        if (end <= 64)
+        {
+            words[w] ^= v << (64 - end);
+        }
+        else
+        {
+            words[w] ^= v >> (end - 64);
+            words[w + 1] ^= v << (128 - end);
+        }
+    }
+
+    /// Append the low \p n bits (1..64) of \p v.
+    void Append(uint64_t v, unsigned n)
+    {
+        Resize(m_size + n);
+        SetBits(m_size - n, n, v);
+    }
+
+    /// Append another bit string.
+    void Append(const BitVec& other)
+    {
+        size_t pos = 0;
+        for (; pos + 64 <= other.Size(); pos += 64)
+        {
+            Append(other.m_words[pos >> 6], 64);
+        }
+        if (pos < other.Size())
+        {
+            Append(other.GetBits(pos, other.Size() - pos), other.Size() - pos);
+        }
+    }
+
+    /// Copy of bits [pos, pos + n).
+    BitVec Slice(size_t pos, size_t n) const
+    {
+        BitVec v(n);
+        for (size_t i = 0; i < n; i += 64)
+        {
+            unsigned k = n - i < 64 ? n - i : 64;
+            v.SetBits(i, k, GetBits(pos + i, k));
+        }
+        return v;
+    }
+
+    /// Word-wide XOR with a bit string of the same length.
+    BitVec& operator^=(const BitVec& other)
+    {
+        for (size_t i = 0; i < m_words.size(); i++)
+        {
+            m_words[i] ^= other.m_words[i];
+        }
+        return *this;
+    }
+
+    bool operator==(const BitVec& other) const
+    {
+        return m_size == other.m_size && m_words == other.m_words;
+    }
+
+    /// Number of set bits.
+    size_t Count() const
+    {
+        size_t c = 0;
+        for (uint64_t w : m_words)
+        {
+            c += __builtin_popcountll(w);
+        }
+        return c;
+    }
+
+    std::string ToString() const
+    {
+        std::string s(m_size, '0');
+        for (size_t i = 0; i < m_size; i++)
+        {
+            if (Get(i))
+            {
+                s[i] = '1';
+            }
+        }
+        return s;
+    }
+
+    /// Zero the unused bits of the last word.
+    void ClearTail()
+    {
+        if (m_size & 63)
+        {
+            m_words.back() &= ~0ULL << (64 - (m_size & 63));
+        }
+    }
+
+    static size_t WordCount(size_t nbits)
+    {
+        return (nbits + 63) / 64;
+    }
+
+  private:
+    std::vector<uint64_t> m_words; //!< Packed bits, MSB first.
+    size_t m_size;                 //!< Number of valid bits.
+};
+
+/**
+ * \brief Bits in words owned by someone else, packed like a BitVec.
+ *
+ * Lets the channel and the receiver work on a caller's buffer with the
+ * same bit operations as on a BitVec. The view never reallocates, so it
+ * cannot grow.
+ */
+class BitSpan
+{
+  public:
+    BitSpan(uint64_t* words, size_t nbits)
+        : m_words(words),
+          m_size(nbits)
+    {
+    }
+
+    size_t Size() const
+    {
+        return m_size;
+    }
+
+    uint64_t* Words() const
+    {
+        return m_words;
+    }
+
+    bool Get(size_t i) const
+    {
+        return (m_words[i >> 6] >> (63 - (i & 63))) & 1;
+    }
+
+    void Flip(size_t i)
+    {
+        m_words[i >> 6] ^= 1ULL << (63 - (i & 63));
+    }
+
+    /// \copydoc BitVec::GetBits
+    uint64_t GetBits(size_t pos, unsigned n) const
+    {
+        return BitVec::GetBits(m_words, pos, n);
+    }
+
+    /// \copydoc BitVec::XorBits
+    void XorBits(size_t pos, unsigned n, uint64_t v)
+    {
+        BitVec::XorBits(m_words, pos, n, v);
+    }
+
+  private:
+    uint64_t* m_words; //!< Borrowed storage.
+    size_t m_size;     //!< Number of valid bits.
+};
+
+/**
+ * \brief Rows x cols bit matrix stored densely in row-major order.
+ *
+ * Row r occupies bits [r * cols, (r + 1) * cols) of one contiguous BitVec,
+ * so a block of 8-bit ASCII codes takes exactly one bit per bit and the
+ * whole block can be walked a word at a time. Row and column views give
+ * per-bit access without copying.
+ */
+class BitBlock
+{
+  public:
+    /// View of one row.
+    class Row
+    {
+      public:
+        Row(BitVec& bits, size_t offset, size_t cols)
+            : m_bits(&bits),
+              m_offset(offset),
+              m_cols(cols)
+        {
+        }
+
+        size_t Size() const
+        {
+            return m_cols;
+        }
+
+        bool Get(size_t c) const
+        {
+            return m_bits->Get(m_offset + c);
+        }
+
+        void Set(size_t c, bool b)
+        {
+            m_bits->Set(m_offset + c, b);
+        }
+
+        void Flip(size_t c)
+        {
+            m_bits->Flip(m_offset + c);
+        }
+
+        /// \copydoc BitVec::GetBits
+        uint64_t GetBits(size_t c, unsigned n) const
+        {
+            return m_bits->GetBits(m_offset + c, n);
+        }
+
+        /// \copydoc BitVec::SetBits
+        void SetBits(size_t c, unsigned n, uint64_t v)
+        {
+            m_bits->SetBits(m_offset + c, n, v);
+        }
+
+      private:
+        BitVec* m_bits;  //!< Backing storage.
+        size_t m_offset; //!< Bit offset of column 0.
+        size_t m_cols;   //!< Row width.
+    };
+
+    /// View of one column.
+    class Column
+    {
+      public:
+        Column(BitVec& bits, size_t col, size_t cols, size_t rows)
+            : m_bits(&bits),
+              m_col(col),
+              m_cols(cols),
+              m_rows(rows)
+        {
+        }
+
+        size_t Size() const
+        {
+            return m_rows;
+        }
+
+        bool Get(size_t r) const
+        {
+            return m_bits->Get(r * m_cols + m_col);
+        }
+
+        void Set(size_t r, bool b)
+        {
+            m_bits->Set(r * m_cols + m_col, b);
+        }
+
+        void Flip(size_t r)
+        {
+            m_bits->Flip(r * m_cols + m_col);
+        }
+
+      private:
+        BitVec* m_bits; //!< Backing storage.
+        size_t m_col;   //!< Column index.
+        size_t m_cols;  //!< Row stride in bits.
+        size_t m_rows;  //!< Column height.
+    };
+
+    BitBlock()
+        : m_rows(0),
+          m_cols(0)
+    {
+    }
+
+    BitBlock(size_t rows, size_t cols)
+        : m_bits(rows * cols),
+          m_rows(rows),
+          m_cols(cols)
+    {
+    }
+
+    /// Wrap an existing row-major bit string of rows * cols bits.
+    BitBlock(BitVec bits, size_t rows, size_t cols)
+        : m_bits(std::move(bits)),
+          m_rows(rows),
+          m_cols(cols)
+    {
+    }
+
+    /**
+     * \brief Become an all-zero rows x cols block.
+     *
+     * The storage is kept, so a block reset to a size it has held before
+     * does not allocate.
+     */
+    void Reset(size_t rows, size_t cols)
+    {
+        m_bits.Resize(rows * cols);
+        std::fill(m_bits.Words(), m_bits.Words() + m_bits.NumWords(), 0);
+        m_rows = rows;
+        m_cols = cols;
+    }
+
+    /**
+     * \brief Become a rows x cols block without clearing it.
+     *
+     * For callers that write every bit anyway: kept bits hold whatever was
+     * there before, and the storage is kept as in Reset.
+     */
+    void Resize(size_t rows, size_t cols)
+    {
+        m_bits.Resize(rows * cols);
+        m_rows = rows;
+        m_cols = cols;
+    }
+
+    size_t Rows() const
+    {
+        return m_rows;
+    }
+
+    size_t Cols() const
+    {
+        return m_cols;
+    }
+
+    bool Get(size_t r, size_t c) const
+    {
+        return m_bits.Get(r * m_cols + c);
+    }
+
+    void Set(size_t r, size_t c, bool b)
+    {
+        m_bits.Set(r * m_cols + c, b);
+    }
+
+    Row RowAt(size_t r)
+    {
+        return Row(m_bits, r * m_cols, m_cols);
+    }
+
+    Column ColumnAt(size_t c)
+    {
+        return Column(m_bits, c, m_cols, m_rows);
+    }
+
+    /// Row-major backing bits.
+    BitVec& Bits()
+    {
+        return m_bits;
+    }
+
+    const BitVec& Bits() const
+    {
+        return m_bits;
+    }
+
+    /// True if row \p r holds the same bits as row \p r of \p other (same width).
+    bool RowEquals(const BitBlock& other, size_t r) const
+    {
+        for (size_t c = 0; c < m_cols; c += 64)
+        {
+            unsigned k = m_cols - c < 64 ? m_cols - c : 64;
+            if (m_bits.GetBits(r * m_cols + c, k) != other.m_bits.GetBits(r * m_cols + c, k))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Number of bits in which row \p r differs from row \p r of \p other (same width).
+    size_t RowDistance(const BitBlock& other, size_t r) const
+    {
+        size_t d = 0;
+        for (size_t c = 0; c < m_cols; c += 64)
+        {
+            unsigned k = m_cols - c < 64 ? m_cols - c : 64;
+            d += __builtin_popcountll(m_bits.GetBits(r * m_cols + c, k) ^ other.m_bits.GetBits(r * m_cols + c, k));
+        }
+        return d;
+    }
+
+    /// Row \p r as a '0'/'1' string.
+    std::string RowString(size_t r) const
+    {
+        std::string s(m_cols, '0');
+        for (size_t c = 0; c < m_cols; c++)
+        {
+            if (Get(r, c))
+            {
+                s[c] = '1';
+            }
+        }
+        return s;
+    }
+
+  private:
+    BitVec m_bits; //!< Row-major bits.
+    size_t m_rows; //!< Number of rows.
+    size_t m_cols; //!< Bits per row.
+};
+
+#endif /* BITBLOCK_H */
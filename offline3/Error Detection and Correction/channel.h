@@ -0,0 +1,440 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "bitblock.h"
+#include "rng.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+/// Failures before the first success of trials with failure probability q, given \p logq = log(q).
+template <typename Rng>
+inline size_t
+GeometricGap(Rng& rng, double logq)
+{
+    double g = std::floor(std::log(UniformOpen0(rng)) / logq);
+    return g < 1e18 ? (size_t)g : (size_t)1e18;
+}
+
+/**
+ * \brief Binary symmetric channel: every bit is toggled independently with probability p.
+ *
+ * For small p the gap to the next toggled bit is drawn from the geometric
+ * distribution and only those positions are flipped, so the cost follows
+ * the number of errors rather than the frame length. From kDenseP upwards
+ * a whole 64-bit error mask is built per word instead: the binary digits
+ * of p, least significant first, pick between AND and OR of fresh random
+ * words, which gives every bit probability p to within 2^-32.
+ */
+class BitFlipChannel
+{
+  public:
+    /// At or above this p, masks are generated a word at a time.
+    static constexpr double kDenseP = 1.0 / 32;
+
+    explicit BitFlipChannel(double p)
+        : m_p(p),
+          m_logq(p > 0 && p < 1 ? std::log1p(-p) : 0),
+          m_fixed(p >= 1 ? 0xFFFFFFFFULL : (uint64_t)std::ldexp(p, 32))
+    {
+    }
+
+    double P() const
+    {
+        return m_p;
+    }
+
+    /**
+     * \brief Toggle bits [begin, end) of \p frame, a BitVec or a BitSpan.
+     * \return number of toggled bits.
+     */
+    template <typename Bits, typename Rng>
+    size_t Apply(Bits& frame, Rng& rng, size_t begin, size_t end) const
+    {
+        if (m_p <= 0 || begin >= end)
+        {
+            return 0;
+        }
+        if (m_p >= kDenseP)
+        {
+            return ApplyDense(frame, rng, begin, end);
+        }
+        size_t flips = 0;
+        for (size_t pos = begin + Gap(rng); pos < end; pos += 1 + Gap(rng))
+        {
+            frame.Flip(pos);
+            flips++;
+        }
+        return flips;
+    }
+
+    /// Toggle bits of the whole frame.
+    template <typename Bits, typename Rng>
+    size_t Apply(Bits& frame, Rng& rng) const
+    {
+        return Apply(frame, rng, 0, frame.Size());
+    }
+
+    /// One 64-bit mask with every bit set with probability p (the dense path).
+    template <typename Rng>
+    uint64_t Mask(Rng& rng) const
+    {
+        if (m_p >= 1)
+        {
+            return ~0ULL;
+        }
+        uint64_t mask = 0;
+        uint64_t f = m_fixed;
+        if (f == 0)
+        {
+            return 0;
+        }
+        f >>= __builtin_ctzll(f); // drop trailing zero digits, they would AND into nothing
+        for (int i = 32 - __builtin_ctzll(m_fixed); i > 0; i--, f >>= 1)
+        {
+            mask = (f & 1) ? mask | rng() : mask & rng();
+        }
+        return mask;
+    }
+
+  private:
+    /// Number of untouched bits before the next toggled one.
+    template <typename Rng>
+    size_t Gap(Rng& rng) const
+    {
+        return GeometricGap(rng, m_logq);
+    }
+
+    template <typename Bits, typename Rng>
+    size_t ApplyDense(Bits& frame, Rng& rng, size_t begin, size_t end) const
+    {
+        size_t flips = 0;
+        for (size_t pos = begin; pos < end; pos += 64)
+        {
+            unsigned n = end - pos < 64 ? end - pos : 64;
+            uint64_t mask = Mask(rng);
+            if (n < 64)
+            {
+                mask &= (1ULL << n) - 1;
+            }
+            frame.XorBits(pos, n, mask);
+            flips += __builtin_popcountll(mask);
+        }
+        return flips;
+    }
+
+    double m_p;        //!< Toggle probability.
+    double m_logq;     //!< log(1 - p), for the geometric gaps.
+    uint64_t m_fixed;  //!< p as a 32-bit binary fraction, for the dense masks.
+};
+
+/**
+ * \brief Gilbert-Elliott channel: a two-state Markov chain, bits toggled
+ * with probability \p good in the good state and \p bad in the bad one.
+ *
+ * It is parametrized by the mean error rate p it should have, the mean
+ * length of a bad-state visit (the burst length) and the two error rates;
+ * the chance to enter the bad state follows from those. That chance is at
+ * most 1, so the burst must be at least s / (1 - s), where s = (p - good)
+ * / (bad - good) is the share of bits spent in the bad state. Every frame
+ * starts in a state drawn from the stationary distribution. The time
+ * spent in each state is drawn as one geometric sojourn and the bits of
+ * that stretch go through a BitFlipChannel, so the cost is one draw per
+ * visit plus that of the i.i.d. channel on the stretch, not one per bit.
+ */
+class GilbertElliottChannel
+{
+  public:
+    /// \param burst mean bits per bad-state visit, >= 1 and >= s / (1 - s); needs good <= p <= bad.
+    GilbertElliottChannel(double p, double burst, double bad = 0.5, double good = 0)
+        : m_good(good),
+          m_bad(bad),
+          m_badShare(bad > good ? (p - good) / (bad - good) : 0)
+    {
+        if (burst < 1 || !(good >= 0 && good <= bad && bad <= 1) || p < good || p > bad)
+        {
+            throw std::invalid_argument("gilbert-elliott needs burst >= 1 and good <= p <= bad <= 1");
+        }
+        double leaveBad = 1 / burst;
+        double leaveGood = m_badShare < 1 ? leaveBad * m_badShare / (1 - m_badShare) : 1;
+        if (leaveGood > 1 + 1e-9) // rounding aside, e.g. p = 0.4 with burst 4
+        {
+            std::ostringstream msg;
+            msg << "gilbert-elliott at p = " << p << " needs burst >= " << m_badShare / (1 - m_badShare)
+                << " for these state error rates";
+            throw std::invalid_argument(msg.str());
+        }
+        leaveGood = std::min(leaveGood, 1.0);
+        m_logStayBad = m_badShare < 1 ? std::log1p(-leaveBad) : 0;
+        m_logStayGood = leaveGood < 1 ? std::log1p(-leaveGood) : -INFINITY;
+    }
+
+    template <typename Bits, typename Rng>
+    size_t Apply(Bits& frame, Rng& rng, size_t begin, size_t end) const
+    {
+        if (m_badShare <= 0 && m_good.P() <= 0)
+        {
+            return 0;
+        }
+        bool bad = UniformOpen0(rng) <= m_badShare;
+        size_t flips = 0;
+        for (size_t pos = begin; pos < end; bad = !bad)
+        {
+            double logStay = bad ? m_logStayBad : m_logStayGood;
+            size_t left = end - pos;
+            size_t stay = logStay < 0 ? 1 + GeometricGap(rng, logStay) : left; // log(1) = 0: never leaves
+            size_t stop = stay < left ? pos + stay : end;
+            flips += (bad ? m_bad : m_good).Apply(frame, rng, pos, stop);
+            pos = stop;
+        }
+        return flips;
+    }
+
+  private:
+    BitFlipChannel m_good;  //!< Errors in the good state.
+    BitFlipChannel m_bad;   //!< Errors in the bad state.
+    double m_badShare;      //!< Stationary probability of the bad state.
+    double m_logStayGood;   //!< log of the chance to stay in the good state for another bit.
+    double m_logStayBad;    //!< log of the chance to stay in the bad state for another bit.
+};
+
+/**
+ * \brief Fixed-length bursts at random positions.
+ *
+ * A burst of length L toggles its first and last bit and each bit in
+ * between with probability 1/2, the usual model of a burst error. Bursts
+ * start at geometric gaps and never overlap, at the rate that gives a
+ * mean bit error rate of p. Each burst takes one random word per 64 bits.
+ */
+class BurstChannel
+{
+  public:
+    /// \param length burst length L >= 1; p must not exceed the (L + 2) / 2L of back-to-back bursts.
+    BurstChannel(double p, size_t length)
+        : m_length(length),
+          m_logq(0)
+    {
+        double perBurst = length <= 2 ? length : (length + 2) / 2.0; // expected toggles in one burst
+        if (length == 0 || p < 0 || p * length > perBurst)
+        {
+            throw std::invalid_argument("burst needs a length >= 1 and p <= (L + 2) / 2L");
+        }
+        if (p > 0)
+        {
+            double rate = 1 / (perBurst / p - length + 1); // burst starts per bit outside bursts
+            m_logq = rate < 1 ? std::log1p(-rate) : -INFINITY;
+        }
+    }
+
+    template <typename Bits, typename Rng>
+    size_t Apply(Bits& frame, Rng& rng, size_t begin, size_t end) const
+    {
+        if (m_logq == 0)
+        {
+            return 0;
+        }
+        size_t flips = 0;
+        for (size_t start = begin + GeometricGap(rng, m_logq); start < end;
+             start += m_length + GeometricGap(rng, m_logq))
+        {
+            size_t last = start + m_length - 1;
+            for (size_t pos = start; pos <= last && pos < end; pos += 64)
+            {
+                unsigned n = std::min<size_t>(std::min<size_t>(last + 1, end) - pos, 64);
+                uint64_t mask = rng();
+                if (pos == start)
+                {
+                    mask |= 1ULL << (n - 1);
+                }
+                if (pos + n == last + 1)
+                {
+                    mask |= 1;
+                }
+                if (n < 64)
+                {
+                    mask &= (1ULL << n) - 1;
+                }
+                frame.XorBits(pos, n, mask);
+                flips += __builtin_popcountll(mask);
+            }
+        }
+        return flips;
+    }
+
+  private:
+    size_t m_length; //!< Burst length.
+    double m_logq;   //!< log(1 - burst start rate), 0 for no bursts.
+};
+
+/**
+ * \brief Replays a recorded error mask.
+ *
+ * Every frame is XORed with the mask read cyclically from a random
+ * offset, so frames of one run see different stretches of the recording
+ * and a frame longer than the recording sees it repeat. The mask is
+ * shared, not copied, between channels.
+ */
+class MaskChannel
+{
+  public:
+    explicit MaskChannel(std::shared_ptr<const BitVec> mask)
+        : m_mask(std::move(mask))
+    {
+        if (!m_mask || m_mask->Size() == 0)
+        {
+            throw std::invalid_argument("error mask is empty");
+        }
+    }
+
+    /// Load a mask written as '0'/'1' characters; everything else, such as line breaks, is skipped.
+    static std::shared_ptr<const BitVec> Load(const std::string& path)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        std::string bits;
+        for (char c; in.get(c);)
+        {
+            if (c == '0' || c == '1')
+            {
+                bits += c;
+            }
+        }
+        return std::make_shared<const BitVec>(BitVec::FromString(bits));
+    }
+
+    template <typename Bits, typename Rng>
+    size_t Apply(Bits& frame, Rng& rng, size_t begin, size_t end) const
+    {
+        const BitVec& mask = *m_mask;
+        size_t size = mask.Size();
+        size_t at = rng() % size;
+        size_t flips = 0;
+        for (size_t pos = begin; pos < end;)
+        {
+            unsigned n = std::min<size_t>(std::min<size_t>(end - pos, 64), size - at);
+            uint64_t v = mask.GetBits(at, n);
+            frame.XorBits(pos, n, v);
+            flips += __builtin_popcountll(v);
+            pos += n;
+            at = at + n == size ? 0 : at + n;
+        }
+        return flips;
+    }
+
+  private:
+    std::shared_ptr<const BitVec> m_mask; //!< Recorded error pattern.
+};
+
+/**
+ * \brief One of the channel models, chosen at run time.
+ *
+ * The models share no base class: each has a templated Apply so that it
+ * works on a BitVec or a BitSpan with any generator, and Channel
+ * dispatches to the one it holds. A Channel is made from a spec (see
+ * Parse) and the mean error rate p, so a sweep over p compares models at
+ * equal bit error rates.
+ */
+class Channel
+{
+  public:
+    /// The i.i.d. channel of probability p.
+    explicit Channel(double p = 0)
+        : m_model(BitFlipChannel(p)),
+          m_name("iid")
+    {
+    }
+
+    /**
+     * \brief The channel \p spec at mean error rate \p p.
+     *
+     * Specs: "iid"; "ge:B[,BAD[,GOOD]]", Gilbert-Elliott with mean burst
+     * B bits and the state error rates (default 0.5 and 0);
+     * "burst:L", bursts of length L; "mask:PATH", a recorded error mask
+     * of '0'/'1' characters replayed from a random offset, p unused.
+     */
+    static Channel Parse(const std::string& spec, double p)
+    {
+        size_t colon = spec.find(':');
+        std::string kind = spec.substr(0, colon);
+        std::string arg = colon == std::string::npos ? "" : spec.substr(colon + 1);
+        std::vector<double> params;
+        if (kind == "ge" || kind == "burst")
+        {
+            std::stringstream ss(arg);
+            for (std::string item; std::getline(ss, item, ',');)
+            {
+                params.push_back(std::stod(item));
+            }
+        }
+        Channel c;
+        c.m_name = spec;
+        if (kind == "iid" && arg.empty())
+        {
+            c.m_model = BitFlipChannel(p);
+        }
+        else if (kind == "ge" && params.size() >= 1 && params.size() <= 3)
+        {
+            c.m_model = GilbertElliottChannel(p, params[0], params.size() > 1 ? params[1] : 0.5,
+                                              params.size() > 2 ? params[2] : 0);
+        }
+        else if (kind == "burst" && params.size() == 1 && params[0] >= 1)
+        {
+            c.m_model = BurstChannel(p, (size_t)params[0]);
+        }
+        else if (kind == "mask" && !arg.empty())
+        {
+            c.m_model = MaskChannel(MaskChannel::Load(arg));
+        }
+        else
+        {
+            throw std::invalid_argument("bad channel " + spec + ", expected iid, ge:B[,BAD[,GOOD]], burst:L or mask:PATH");
+        }
+        return c;
+    }
+
+    /// The channel with every parameter but p kept; a mask channel is shared, not reloaded.
+    Channel WithP(double p) const
+    {
+        if (std::holds_alternative<MaskChannel>(m_model))
+        {
+            return *this;
+        }
+        return Parse(m_name, p);
+    }
+
+    const std::string& Name() const
+    {
+        return m_name;
+    }
+
+    /// \copydoc BitFlipChannel::Apply
+    template <typename Bits, typename Rng>
+    size_t Apply(Bits& frame, Rng& rng, size_t begin, size_t end) const
+    {
+        return std::visit([&](const auto& model) { return model.Apply(frame, rng, begin, end); }, m_model);
+    }
+
+    template <typename Bits, typename Rng>
+    size_t Apply(Bits& frame, Rng& rng) const
+    {
+        return Apply(frame, rng, 0, frame.Size());
+    }
+
+  private:
+    std::variant<BitFlipChannel, GilbertElliottChannel, BurstChannel, MaskChannel> m_model; //!< The model.
+    std::string m_name; //!< Spec it was made from.
+};
+
+#endif /* CHANNEL_H */
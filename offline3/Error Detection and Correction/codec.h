@@ -0,0 +1,456 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include "arena.h"
+#include "bitblock.h"
+#include "crc.h"
+#include "fixed_codec.h"
+#include "hamming.h"
+#include "reed_solomon.h"
+#include "transpose.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// What the fused receiver found out about a frame.
+struct ReceiveResult
+{
+    bool crcOk;           //!< The frame left no CRC remainder.
+    size_t rowsCorrected; //!< Rows with a non-zero syndrome.
+};
+
+/**
+ * \brief The Hamming + CRC pipeline of the assignment, stage by stage, without printing.
+ *
+ * Sender: Pad, DataBlock, AddCheckBits, Serialize, AppendCrc.
+ * Receiver: CheckCrc, Deserialize, CorrectRows, RemoveCheckBits, Ascii,
+ * or all of them at once with Receive.
+ * The interactive run prints between the stages; sweeps and other batch
+ * users call them back to back.
+ *
+ * Configurations with a compile-time kernel (see FindKernel) encode,
+ * correct and checksum through it; the others use the generic engines.
+ * With Reed-Solomon parity bytes instead of Hamming check bits the same
+ * stages run, only the row code differs.
+ */
+class Codec
+{
+  public:
+    /**
+     * \param m characters per row. \param generator CRC generator bit string.
+     * \param specialize use a compile-time kernel if one matches.
+     * \param rsParity Reed-Solomon parity bytes per row in place of the
+     * Hamming check bits; 0 for Hamming. Compile-time kernels are Hamming
+     * kernels, so they are not used with Reed-Solomon.
+     */
+    Codec(size_t m, const std::string& generator, bool specialize = true, size_t rsParity = 0)
+        : m_m(m),
+          m_hamming(8 * m),
+          m_crc(generator),
+          m_rs(rsParity ? std::make_shared<const ReedSolomon>(m, rsParity) : nullptr),
+          m_kernel(specialize && !rsParity ? FindKernel(m, m_crc.Poly(), m_crc.Degree()) : nullptr)
+    {
+    }
+
+    /// True if a compile-time kernel handles this configuration.
+    bool Specialized() const
+    {
+        return m_kernel != nullptr;
+    }
+
+    size_t M() const
+    {
+        return m_m;
+    }
+
+    const Hamming& GetHamming() const
+    {
+        return m_hamming;
+    }
+
+    const CrcEngine& Crc() const
+    {
+        return m_crc;
+    }
+
+    /// The Reed-Solomon row code, or nullptr for Hamming.
+    const ReedSolomon* GetReedSolomon() const
+    {
+        return m_rs.get();
+    }
+
+    /// Bits of an encoded row.
+    size_t CodeBits() const
+    {
+        return m_rs ? m_rs->CodeBits() : m_hamming.CodeBits();
+    }
+
+    /// True if 0-indexed column \p col of an encoded row holds a check bit or parity bit.
+    bool IsCheckColumn(size_t col) const
+    {
+        return m_rs ? m_rs->IsCheckColumn(col) : Hamming::IsCheckColumn(col);
+    }
+
+    /// Append '~' until the length is a multiple of m.
+    std::string Pad(std::string data) const
+    {
+        if (data.size() % m_m)
+        {
+            data.append(m_m - data.size() % m_m, '~');
+        }
+        return data;
+    }
+
+    /// The ASCII codes of a padded string, m characters per row.
+    BitBlock DataBlock(const std::string& padded) const
+    {
+        return BitBlock(BitVec::FromBytes(padded), padded.size() / m_m, 8 * m_m);
+    }
+
+    /// Pad and DataBlock in one go, into \p block, reusing its storage.
+    void DataBlock(const char* data, size_t len, BitBlock& block) const
+    {
+        size_t rows = (len + m_m - 1) / m_m;
+        block.Reset(rows, 8 * m_m);
+        BitVec& bits = block.Bits();
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8)
+        {
+            uint64_t w = 0;
+            for (int k = 0; k < 8; k++)
+            {
+                w = (w << 8) | (unsigned char)data[i + k];
+            }
+            bits.Words()[i / 8] = w;
+        }
+        for (; i < rows * m_m; i++)
+        {
+            bits.XorBits(i * 8, 8, i < len ? (unsigned char)data[i] : '~');
+        }
+    }
+
+    BitBlock AddCheckBits(const BitBlock& block) const
+    {
+        BitBlock code;
+        AddCheckBits(block, code);
+        return code;
+    }
+
+    /// AddCheckBits into \p code, reusing its storage.
+    void AddCheckBits(const BitBlock& block, BitBlock& code) const
+    {
+        if (m_rs)
+        {
+            m_rs->Encode(block, code);
+            return;
+        }
+        if (!m_kernel)
+        {
+            m_hamming.Encode(block, code);
+            return;
+        }
+        code.Reset(block.Rows(), m_hamming.CodeBits());
+        m_kernel->Encode(block, code);
+    }
+
+    BitVec Serialize(const BitBlock& encoded) const
+    {
+        return SerializeColumns(encoded);
+    }
+
+    /// Serialize into \p out, reusing its storage.
+    void Serialize(const BitBlock& encoded, BitVec& out) const
+    {
+        TransposeBits(encoded.Bits(), encoded.Rows(), encoded.Cols(), out);
+    }
+
+    /**
+     * \brief CRC of the first \p nbits bits.
+     *
+     * Frames above CrcEngine::kParallelGrain are split across cores, unless
+     * the thread is InParallelFor; then they stay on this thread and do not
+     * allocate.
+     */
+    uint64_t Checksum(const BitVec& bits, size_t nbits) const
+    {
+        return Checksum(bits.Words(), nbits);
+    }
+
+    /// \copydoc Checksum(const BitVec&, size_t) const
+    uint64_t Checksum(const uint64_t* words, size_t nbits) const
+    {
+        if (m_kernel && (nbits <= CrcEngine::kParallelGrain || InParallelFor()))
+        {
+            return m_kernel->Checksum(words, nbits);
+        }
+        return m_crc.ComputeWordsParallel(words, nbits);
+    }
+
+    /// The sent frame: serialized bits followed by the CRC checksum.
+    BitVec AppendCrc(const BitVec& serialized) const
+    {
+        BitVec frame = serialized;
+        if (m_crc.Degree())
+        {
+            frame.Append(Checksum(serialized, serialized.Size()), m_crc.Degree());
+        }
+        return frame;
+    }
+
+    /// AppendCrc in place; does not allocate if \p frame has room for the checksum.
+    void AppendCrcInPlace(BitVec& frame) const
+    {
+        if (m_crc.Degree())
+        {
+            frame.Append(Checksum(frame, frame.Size()), m_crc.Degree());
+        }
+    }
+
+    /// Number of data bits in a frame, i.e. without the checksum.
+    size_t PayloadBits(const BitVec& frame) const
+    {
+        return frame.Size() - m_crc.Degree();
+    }
+
+    /// True if the received frame leaves no remainder.
+    bool CheckCrc(const BitVec& frame) const
+    {
+        return CheckCrc(frame.Words(), frame.Size());
+    }
+
+    /// \copydoc CheckCrc(const BitVec&) const
+    bool CheckCrc(const uint64_t* words, size_t nbits) const
+    {
+        size_t n = nbits - m_crc.Degree();
+        uint64_t received = m_crc.Degree() ? BitVec::GetBits(words, n, m_crc.Degree()) : 0;
+        return Checksum(words, n) == received;
+    }
+
+    /// Strip the checksum and undo the column-major serialization.
+    BitBlock Deserialize(const BitVec& frame) const
+    {
+        BitBlock block;
+        Deserialize(frame, block);
+        return block;
+    }
+
+    /// Deserialize into \p block, reusing its storage; the checksum is skipped rather than copied off.
+    void Deserialize(const BitVec& frame, BitBlock& block) const
+    {
+        DeserializeColumns(frame, FrameRows(frame), CodeBits(), block);
+    }
+
+    /// Correct one bit (Hamming) or t bytes (Reed-Solomon) per row in place; returns rows with a non-zero syndrome.
+    size_t CorrectRows(BitBlock& received) const
+    {
+        if (m_rs)
+        {
+            return m_rs->Correct(received);
+        }
+        return m_kernel ? m_kernel->Correct(received) : m_hamming.Correct(received);
+    }
+
+    BitBlock RemoveCheckBits(const BitBlock& corrected) const
+    {
+        return m_rs ? m_rs->Strip(corrected) : m_hamming.Strip(corrected);
+    }
+
+    /// Number of rows a frame carries.
+    size_t FrameRows(const BitVec& frame) const
+    {
+        return FrameRows(frame.Size());
+    }
+
+    /// Number of rows a frame of \p nbits bits carries.
+    size_t FrameRows(size_t nbits) const
+    {
+        return (nbits - m_crc.Degree()) / CodeBits();
+    }
+
+    /// Bits of the frame that carries \p len bytes.
+    size_t FrameBits(size_t len) const
+    {
+        return (len + m_m - 1) / m_m * CodeBits() + m_crc.Degree();
+    }
+
+    /**
+     * \brief CheckCrc, Deserialize, CorrectRows, RemoveCheckBits and Ascii in one sweep.
+     * \param out room for FrameRows(frame) * m characters.
+     *
+     * The CRC is checked over the packed frame in place. The serialized
+     * frame is column-major, so bits [c * rows + 64g, +64) are already the
+     * bitsliced column c of rows 64g..64g+63: the rest is one sweep over
+     * groups of 64 rows in which the syndromes are XORs of column words,
+     * bad rows are fixed in the slices and the data columns are transposed
+     * straight into characters. No intermediate frame or block is built.
+     */
+    ReceiveResult Receive(const BitVec& frame, char* out) const
+    {
+        return Receive(frame.Words(), frame.Size(), out);
+    }
+
+    /**
+     * \brief Receive a frame of \p nbits bits held in bare words.
+     *
+     * The scratch slices come from the thread's FrameArena, so this does
+     * not allocate once the arena has grown to the frame size.
+     */
+    ReceiveResult Receive(const uint64_t* words, size_t nbits, char* out) const
+    {
+        if (m_rs)
+        {
+            return ReceiveReedSolomon(words, nbits, out);
+        }
+        size_t n = m_hamming.CodeBits();
+        size_t k = m_hamming.DataBits();
+        size_t r = m_hamming.CheckBits();
+        size_t rows = FrameRows(nbits);
+        const std::vector<size_t>& dataPos = m_hamming.DataPositions();
+        ArenaScope scope;
+        uint64_t* slices = scope.Arena().Words(n);
+        uint64_t* syndrome = scope.Arena().Words(r);
+        Transpose64Fn kernel = Transpose64Best();
+        alignas(32) uint64_t tile[64];
+        ReceiveResult res{CheckCrc(words, nbits), 0};
+
+        for (size_t g = 0; g < rows; g += 64)
+        {
+            unsigned nr = rows - g < 64 ? rows - g : 64;
+            std::fill(syndrome, syndrome + r, 0);
+            for (size_t c = 0; c < n; c++)
+            {
+                uint64_t w = BitVec::GetBits(words, c * rows + g, nr) << (64 - nr);
+                slices[c] = w;
+                for (size_t i = 0; i < r; i++)
+                {
+                    if (((c + 1) >> i) & 1)
+                    {
+                        syndrome[i] ^= w;
+                    }
+                }
+            }
+            uint64_t bad = 0;
+            for (size_t i = 0; i < r; i++)
+            {
+                bad |= syndrome[i];
+            }
+            while (bad)
+            {
+                unsigned row = __builtin_clzll(bad); // row i sits at bit 63 - i
+                size_t s = 0;
+                for (size_t i = 0; i < r; i++)
+                {
+                    s |= ((syndrome[i] >> (63 - row)) & 1) << i;
+                }
+                if (s <= n)
+                {
+                    slices[s - 1] ^= 1ULL << (63 - row);
+                }
+                res.rowsCorrected++;
+                bad &= ~(1ULL << (63 - row));
+            }
+            for (size_t cb = 0; cb < k; cb += 64)
+            {
+                unsigned nc = k - cb < 64 ? k - cb : 64;
+                for (unsigned j = 0; j < nc; j++)
+                {
+                    tile[j] = slices[dataPos[cb + j] - 1];
+                }
+                for (unsigned j = nc; j < 64; j++)
+                {
+                    tile[j] = 0;
+                }
+                kernel(tile);
+                for (unsigned i = 0; i < nr; i++)
+                {
+                    char* dst = out + (g + i) * m_m + cb / 8;
+                    for (unsigned b = 0; b < nc / 8; b++)
+                    {
+                        dst[b] = (char)(tile[i] >> (56 - 8 * b));
+                    }
+                }
+            }
+        }
+
+        return res;
+    }
+
+    /// Characters of a data block.
+    static std::string Ascii(const BitBlock& block)
+    {
+        std::string data(block.Bits().Size() / 8, '\0');
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = (char)block.Bits().GetBits(i * 8, 8);
+        }
+        return data;
+    }
+
+  private:
+    /**
+     * \brief Receive with the Reed-Solomon row code.
+     *
+     * Groups of up to ReedSolomon::kGroupRows rows are turned from bit
+     * columns into byte columns with the 64x64 tile transpose, 64 rows
+     * and 64 bit columns (8 bytes) per tile, corrected in byte columns
+     * and copied out row by row.
+     */
+    ReceiveResult ReceiveReedSolomon(const uint64_t* words, size_t nbits, char* out) const
+    {
+        const size_t kGroup = ReedSolomon::kGroupRows;
+        size_t nc = m_rs->CodeBits();
+        size_t rows = FrameRows(nbits);
+        ArenaScope scope;
+        uint8_t* cols = (uint8_t*)scope.Arena().Words(m_rs->CodeBytes() * kGroup / 8);
+        Transpose64Fn kernel = Transpose64Best();
+        alignas(32) uint64_t tile[64];
+        ReceiveResult res{CheckCrc(words, nbits), 0};
+
+        for (size_t g = 0; g < rows; g += kGroup)
+        {
+            size_t groupRows = std::min(kGroup, rows - g);
+            for (size_t s = 0; s < groupRows; s += 64)
+            {
+                unsigned nr = groupRows - s < 64 ? groupRows - s : 64;
+                for (size_t cb = 0; cb < nc; cb += 64)
+                {
+                    unsigned w = nc - cb < 64 ? nc - cb : 64;
+                    for (unsigned j = 0; j < w; j++)
+                    {
+                        tile[j] = BitVec::GetBits(words, (cb + j) * rows + g + s, nr) << (64 - nr);
+                    }
+                    std::fill(tile + w, tile + 64, 0);
+                    kernel(tile);
+                    for (unsigned i = 0; i < nr; i++)
+                    {
+                        for (unsigned b = 0; b < w / 8; b++)
+                        {
+                            cols[(cb / 8 + b) * kGroup + s + i] = (uint8_t)(tile[i] >> (56 - 8 * b));
+                        }
+                    }
+                }
+            }
+            res.rowsCorrected += m_rs->CorrectColumns(cols, kGroup, groupRows);
+            for (size_t i = 0; i < groupRows; i++)
+            {
+                for (size_t j = 0; j < m_m; j++)
+                {
+                    out[(g + i) * m_m + j] = (char)cols[j * kGroup + i];
+                }
+            }
+        }
+        return res;
+    }
+
+    size_t m_m;          //!< Characters per row.
+    Hamming m_hamming;   //!< Row code for 8m data bits.
+    CrcEngine m_crc;     //!< Frame checksum.
+    std::shared_ptr<const ReedSolomon> m_rs;     //!< Reed-Solomon row code, or nullptr for Hamming.
+    std::shared_ptr<const CodecKernel> m_kernel; //!< Compile-time kernel, or nullptr.
+};
+
+#endif /* CODEC_H */
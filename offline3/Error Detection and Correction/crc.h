@@ -0,0 +1,379 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Table-driven CRC engine for an arbitrary generator polynomial.
+ *
+ * Computes the textbook CRC of figure 3-8 in Tanenbaum: the remainder of
+ * M(x) * x^r divided by G(x), where r is the degree of G. The message is
+ * consumed MSB first, exactly as the bit string is printed.
+ *
+ * The register is kept left-aligned in a 64-bit word, so one set of tables
+ * serves every degree from 1 to 64 (CRC-8, CRC-16, CRC-32, odd-degree
+ * custom generators, ...). Tables are built at runtime from the generator;
+ * whole bytes go through slice-by-8 or slice-by-16 lookups and a trailing
+ * partial byte is divided bit by bit.
+ *
+ * There is no initial value or final XOR, so the CRC is linear and the
+ * checksums of two pieces combine into the checksum of their
+ * concatenation (Combine). Large inputs are cut into pieces that are
+ * checksummed on separate threads and merged (ComputeWordsParallel).
+ */
+class CrcEngine
+{
+  public:
+    /// Number of slice tables; slice-by-16 uses all of them, slice-by-8 the first 8.
+    static const int kSlices = 16;
+
+    /// Bits per piece of ComputeWordsParallel, a multiple of 64.
+    static const size_t kParallelGrain = size_t(1) << 23;
+
+    /**
+     * \brief Build the engine from a generator given as a bit string.
+     * \param generator e.g. "10101" for x^4 + x^2 + 1. Leading zeros are ignored.
+     */
+    explicit CrcEngine(const std::string& generator)
+    {
+        size_t first = generator.find('1');
+        if (generator.empty() || generator.find_first_not_of("01") != std::string::npos ||
+            first == std::string::npos)
+        {
+            throw std::invalid_argument("generator polynomial must be a non-zero bit string");
+        }
+        std::string g = generator.substr(first);
+        if (g.size() - 1 > 64)
+        {
+            throw std::invalid_argument("generator polynomial degree must be at most 64");
+        }
+        uint64_t poly = 0;
+        for (size_t i = 1; i < g.size(); i++)
+        {
+            poly = (poly << 1) | (uint64_t)(g[i] - '0');
+        }
+        Init(poly, (unsigned)(g.size() - 1));
+    }
+
+    /**
+     * \brief Build the engine from a polynomial without its leading x^degree term.
+     * \param poly low \p degree coefficients of G, e.g. 0x1021 for CRC-16-CCITT.
+     * \param degree degree of G, 0..64.
+     */
+    CrcEngine(uint64_t poly, unsigned degree)
+    {
+        if (degree > 64)
+        {
+            throw std::invalid_argument("generator polynomial degree must be at most 64");
+        }
+        Init(poly, degree);
+    }
+
+    /// Degree of the generator, i.e. the number of checksum bits.
+    unsigned Degree() const
+    {
+        return m_degree;
+    }
+
+    /// Low \c Degree() coefficients of the generator, right-aligned.
+    uint64_t Poly() const
+    {
+        return m_degree == 0 ? 0 : m_poly >> (64 - m_degree);
+    }
+
+    /**
+     * \brief Feed whole bytes into a left-aligned register.
+     * \param reg register from a previous call, 0 to start.
+     * \param slices 16 or 8 bytes per iteration (anything else runs byte-wise).
+     * \return the updated left-aligned register.
+     */
+    uint64_t Update(uint64_t reg, const uint8_t* data, size_t nbytes, int slices = kSlices) const
+    {
+        if (m_degree == 0)
+        {
+            return 0;
+        }
+        if (slices == 16)
+        {
+            for (; nbytes >= 16; nbytes -= 16, data += 16)
+            {
+                reg = Slice16(reg ^ LoadBe64(data), LoadBe64(data + 8));
+            }
+        }
+        if (slices >= 8)
+        {
+            for (; nbytes >= 8; nbytes -= 8, data += 8)
+            {
+                reg = Slice8(reg ^ LoadBe64(data));
+            }
+        }
+        for (; nbytes > 0; nbytes--, data++)
+        {
+            reg = (reg << 8) ^ m_table[0][(reg >> 56) ^ *data];
+        }
+        return reg;
+    }
+
+    /**
+     * \brief Feed \p nbits bits held MSB first in 64-bit words.
+     *
+     * Same bit order as BitVec, so a packed frame is checksummed in place
+     * without converting it to bytes. Full words go through slice-by-16.
+     */
+    uint64_t UpdateWords(uint64_t reg, const uint64_t* words, size_t nbits) const
+    {
+        if (m_degree == 0)
+        {
+            return 0;
+        }
+        size_t n = nbits / 64;
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2)
+        {
+            reg = Slice16(reg ^ words[i], words[i + 1]);
+        }
+        if (i < n)
+        {
+            reg = Slice8(reg ^ words[i++]);
+        }
+        unsigned rest = nbits % 64;
+        if (rest)
+        {
+            uint64_t w = words[i];
+            for (; rest >= 8; rest -= 8, w <<= 8)
+            {
+                reg = (reg << 8) ^ m_table[0][(reg ^ w) >> 56];
+            }
+            reg = UpdateBits(reg, w, rest);
+        }
+        return reg;
+    }
+
+    /// CRC of the first \p nbits bits of MSB-first packed words.
+    uint64_t ComputeWords(const uint64_t* words, size_t nbits) const
+    {
+        return Finish(UpdateWords(0, words, nbits));
+    }
+
+    /**
+     * \brief ComputeWords on up to \p threads threads (0 for all cores).
+     *
+     * The input is cut into pieces of \p grain bits, every piece is
+     * checksummed from a zero register and the results are merged in order
+     * with Combine. Gives the same result as ComputeWords. Inside a
+     * ParallelFor task or a SerialScope it is ComputeWords, so callers that
+     * already keep every core busy do not start a pool per frame.
+     */
+    uint64_t ComputeWordsParallel(const uint64_t* words, size_t nbits, size_t threads = 0,
+                                  size_t grain = kParallelGrain) const
+    {
+        grain = std::max<size_t>(64, grain / 64 * 64);
+        size_t pieces = (nbits + grain - 1) / grain;
+        if (pieces <= 1 || threads == 1 || InParallelFor())
+        {
+            return ComputeWords(words, nbits);
+        }
+        std::vector<uint64_t> crc(pieces);
+        ParallelFor(pieces, threads, [&](size_t i) {
+            size_t first = i * grain;
+            crc[i] = ComputeWords(words + first / 64, std::min(grain, nbits - first));
+        });
+        uint64_t total = crc[0];
+        for (size_t i = 1; i < pieces; i++)
+        {
+            total = Combine(total, crc[i], std::min(grain, nbits - i * grain));
+        }
+        return total;
+    }
+
+    /**
+     * \brief CRC of A followed by B, from the CRCs of A and B alone.
+     * \param crcA right-aligned checksum of A, as returned by Finish.
+     * \param crcB right-aligned checksum of B.
+     * \param lenB length of B in bits.
+     *
+     * CRC(A || B) = CRC(A) * x^lenB mod G + CRC(B), and x^lenB mod G is put
+     * together from the stored powers x^(2^k) mod G, one multiplication per
+     * set bit of \p lenB. The cost does not depend on the lengths.
+     */
+    uint64_t Combine(uint64_t crcA, uint64_t crcB, uint64_t lenB) const
+    {
+        return Shift(crcA, lenB) ^ crcB;
+    }
+
+    /// \p crc * x^nbits mod G, i.e. the CRC of a message followed by \p nbits zero bits.
+    uint64_t Shift(uint64_t crc, uint64_t nbits) const
+    {
+        if (m_degree == 0)
+        {
+            return 0;
+        }
+        uint64_t reg = crc << (64 - m_degree);
+        for (unsigned k = 0; nbits; k++, nbits >>= 1)
+        {
+            if (nbits & 1)
+            {
+                reg = MulMod(reg, m_xpow[k]);
+            }
+        }
+        return Finish(reg);
+    }
+
+    /**
+     * \brief Feed the top \p nbits bits of \p bits (MSB first) one at a time.
+     */
+    uint64_t UpdateBits(uint64_t reg, uint64_t bits, unsigned nbits) const
+    {
+        if (m_degree == 0)
+        {
+            return 0;
+        }
+        for (unsigned i = 0; i < nbits; i++)
+        {
+            reg ^= (bits << i) & (1ULL << 63);
+            reg = (reg & (1ULL << 63)) ? (reg << 1) ^ m_poly : reg << 1;
+        }
+        return reg;
+    }
+
+    /// Convert a left-aligned register into the right-aligned remainder.
+    uint64_t Finish(uint64_t reg) const
+    {
+        return m_degree == 0 ? 0 : reg >> (64 - m_degree);
+    }
+
+    /**
+     * \brief CRC of a packed MSB-first bit string.
+     * \param data bytes holding the bits, bit 0 of the string is the MSB of data[0].
+     * \param nbits number of valid bits; the tail of the last byte is ignored.
+     */
+    uint64_t Compute(const uint8_t* data, size_t nbits) const
+    {
+        uint64_t reg = Update(0, data, nbits / 8);
+        if (nbits % 8)
+        {
+            reg = UpdateBits(reg, (uint64_t)data[nbits / 8] << 56, nbits % 8);
+        }
+        return Finish(reg);
+    }
+
+    /// Checksum rendered as \c Degree() characters of '0'/'1'.
+    std::string ToBits(uint64_t crc) const
+    {
+        std::string s(m_degree, '0');
+        for (unsigned i = 0; i < m_degree; i++)
+        {
+            if ((crc >> (m_degree - 1 - i)) & 1)
+            {
+                s[i] = '1';
+            }
+        }
+        return s;
+    }
+
+  private:
+    void Init(uint64_t poly, unsigned degree)
+    {
+        if (degree < 64 && (poly >> degree) != 0)
+        {
+            throw std::invalid_argument("polynomial has bits above its degree");
+        }
+        m_degree = degree;
+        m_poly = degree == 0 ? 0 : poly << (64 - degree);
+        m_table.resize(kSlices);
+        for (int i = 0; i < 256; i++)
+        {
+            uint64_t reg = (uint64_t)i << 56;
+            for (int b = 0; b < 8; b++)
+            {
+                reg = (reg & (1ULL << 63)) ? (reg << 1) ^ m_poly : reg << 1;
+            }
+            m_table[0][i] = reg;
+        }
+        if (degree > 0)
+        {
+            m_xpow[0] = MulX(uint64_t(1) << (64 - degree)); // x^1
+            for (int k = 1; k < 64; k++)
+            {
+                m_xpow[k] = MulMod(m_xpow[k - 1], m_xpow[k - 1]);
+            }
+        }
+        for (int k = 1; k < kSlices; k++)
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                uint64_t prev = m_table[k - 1][i];
+                m_table[k][i] = (prev << 8) ^ m_table[0][prev >> 56];
+            }
+        }
+    }
+
+    /// Left-aligned a * x mod G.
+    uint64_t MulX(uint64_t a) const
+    {
+        return (a & (1ULL << 63)) ? (a << 1) ^ m_poly : a << 1;
+    }
+
+    /// Left-aligned a * b mod G, Horner over the coefficients of b from the top.
+    uint64_t MulMod(uint64_t a, uint64_t b) const
+    {
+        uint64_t acc = 0;
+        for (unsigned i = 0; i < m_degree; i++)
+        {
+            acc = MulX(acc);
+            if ((b >> (63 - i)) & 1)
+            {
+                acc ^= a;
+            }
+        }
+        return acc;
+    }
+
+    /// Advance a register whose top 64 bits have already been XORed with data.
+    uint64_t Slice8(uint64_t x) const
+    {
+        return m_table[7][x >> 56] ^ m_table[6][(x >> 48) & 0xff] ^
+               m_table[5][(x >> 40) & 0xff] ^ m_table[4][(x >> 32) & 0xff] ^
+               m_table[3][(x >> 24) & 0xff] ^ m_table[2][(x >> 16) & 0xff] ^
+               m_table[1][(x >> 8) & 0xff] ^ m_table[0][x & 0xff];
+    }
+
+    /// Slice-by-16 step: \p x is register ^ first word, \p y the second word.
+    uint64_t Slice16(uint64_t x, uint64_t y) const
+    {
+        return m_table[15][x >> 56] ^ m_table[14][(x >> 48) & 0xff] ^
+               m_table[13][(x >> 40) & 0xff] ^ m_table[12][(x >> 32) & 0xff] ^
+               m_table[11][(x >> 24) & 0xff] ^ m_table[10][(x >> 16) & 0xff] ^
+               m_table[9][(x >> 8) & 0xff] ^ m_table[8][x & 0xff] ^
+               m_table[7][y >> 56] ^ m_table[6][(y >> 48) & 0xff] ^
+               m_table[5][(y >> 40) & 0xff] ^ m_table[4][(y >> 32) & 0xff] ^
+               m_table[3][(y >> 24) & 0xff] ^ m_table[2][(y >> 16) & 0xff] ^
+               m_table[1][(y >> 8) & 0xff] ^ m_table[0][y & 0xff];
+    }
+
+    static uint64_t LoadBe64(const uint8_t* p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        v = __builtin_bswap64(v);
+#endif
+        return v;
+    }
+
+    unsigned m_degree;                          //!< Degree of G.
+    uint64_t m_poly;                            //!< G without x^degree, left-aligned.
+    std::vector<std::array<uint64_t, 256>> m_table; //!< Slice tables, m_table[k] advances 8*(k+1) bits.
+    std::array<uint64_t, 64> m_xpow;            //!< x^(2^k) mod G, left-aligned.
+};
+
+#endif /* CRC_H */
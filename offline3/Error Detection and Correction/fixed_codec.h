@@ -0,0 +1,598 @@
+#ifndef FIXED_CODEC_H
+#define FIXED_CODEC_H
+
+#include "bitblock.h"
+#include "hamming.h"
+#include "transpose.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/**
+ * \file
+ * \brief Codec kernels specialized at compile time for a fixed m and generator.
+ *
+ * The generic Hamming and CrcEngine classes work out their layout and
+ * tables when they are constructed. For the configurations that are run
+ * most, FixedKernel<M, Poly, Degree> has all of it generated as constexpr
+ * data instead: the check-bit masks, the data-bit moves, the
+ * syndrome-to-bit table and the CRC slice tables. Row loops then have
+ * compile-time trip counts and unroll completely, and there is no table
+ * setup at runtime.
+ *
+ * Codec asks FindKernel for a match when it is built and forwards
+ * encoding, correction and checksumming to the kernel it gets back; for
+ * every other configuration it keeps using the generic engines.
+ */
+
+/// The stages a specialized kernel takes over from the generic engines.
+class CodecKernel
+{
+  public:
+    virtual ~CodecKernel() = default;
+
+    /// Hamming-encode every row of \p data into the zeroed block \p code.
+    virtual void Encode(const BitBlock& data, BitBlock& code) const = 0;
+
+    /// Fix at most one bit per row in place; returns rows with a non-zero syndrome.
+    virtual size_t Correct(BitBlock& code) const = 0;
+
+    /// CRC of the first \p nbits bits of MSB-first packed words.
+    virtual uint64_t Checksum(const uint64_t* words, size_t nbits) const = 0;
+};
+
+/// Smallest r with 2^r >= n + r + 1, as Hamming::CheckBitCount.
+constexpr size_t
+FixedCheckBits(size_t n)
+{
+    size_t r = 0;
+    while ((size_t(1) << r) < n + r + 1)
+    {
+        r++;
+    }
+    return r;
+}
+
+/// One data-to-codeword move of FixedHamming: \p len bits from data bit \p src to codeword bit \p dst.
+struct FixedMove
+{
+    size_t src;
+    size_t dst;
+    size_t len;
+};
+
+/// Flip target of a syndrome: word and bit of the codeword, mask 0 if out of range.
+struct FixedFlip
+{
+    size_t word;
+    uint64_t mask;
+};
+
+/**
+ * \brief Walk the data bits of a row in order, calling \p emit for each move.
+ *
+ * A move is a run of data bits whose codeword columns are consecutive
+ * non-check columns and which crosses a 64-bit word boundary neither in
+ * the data row nor in the codeword.
+ */
+template <typename Emit>
+constexpr void
+FixedWalkMoves(size_t dataBits, Emit emit)
+{
+    size_t src = 0;
+    size_t col = 0;
+    while (src < dataBits)
+    {
+        while (((col + 1) & col) == 0)
+        {
+            col++;
+        }
+        size_t len = 1;
+        while (src + len < dataBits && (src + len) % 64 && (col + len) % 64 && ((col + len + 1) & (col + len)))
+        {
+            len++;
+        }
+        emit(FixedMove{src, col, len});
+        src += len;
+        col += len;
+    }
+}
+
+constexpr size_t
+FixedMoveCount(size_t dataBits)
+{
+    size_t n = 0;
+    FixedWalkMoves(dataBits, [&n](FixedMove) { n++; });
+    return n;
+}
+
+template <size_t DataBits, size_t Moves>
+constexpr std::array<FixedMove, Moves>
+FixedMoves()
+{
+    std::array<FixedMove, Moves> moves{};
+    size_t n = 0;
+    FixedWalkMoves(DataBits, [&](FixedMove mv) { moves[n++] = mv; });
+    return moves;
+}
+
+/// Mask i covers the columns whose 1-indexed position has bit i set.
+template <size_t CodeBits, size_t Words, size_t CheckBits>
+constexpr std::array<std::array<uint64_t, Words>, CheckBits>
+FixedMasks()
+{
+    std::array<std::array<uint64_t, Words>, CheckBits> masks{};
+    for (size_t i = 0; i < CheckBits; i++)
+    {
+        for (size_t col = 0; col < CodeBits; col++)
+        {
+            if (((col + 1) >> i) & 1)
+            {
+                masks[i][col / 64] |= uint64_t(1) << (63 - col % 64);
+            }
+        }
+    }
+    return masks;
+}
+
+/// Syndrome s names 1-indexed position s; syndromes past the codeword flip nothing.
+template <size_t CodeBits, size_t CheckBits>
+constexpr std::array<FixedFlip, (size_t(1) << CheckBits)>
+FixedFlips()
+{
+    std::array<FixedFlip, (size_t(1) << CheckBits)> flips{};
+    for (size_t s = 1; s <= CodeBits; s++)
+    {
+        flips[s] = FixedFlip{(s - 1) / 64, uint64_t(1) << (63 - (s - 1) % 64)};
+    }
+    return flips;
+}
+
+/// Slice tables of CrcEngine for the left-aligned generator \p Poly, kept in the top bits of \p Reg.
+template <typename Reg, uint64_t Poly>
+constexpr std::array<std::array<Reg, 256>, 16>
+FixedCrcTables()
+{
+    std::array<std::array<uint64_t, 256>, 16> t{};
+    for (int i = 0; i < 256; i++)
+    {
+        uint64_t reg = (uint64_t)i << 56;
+        for (int b = 0; b < 8; b++)
+        {
+            reg = (reg & (1ULL << 63)) ? (reg << 1) ^ Poly : reg << 1;
+        }
+        t[0][i] = reg;
+    }
+    for (int k = 1; k < 16; k++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            t[k][i] = (t[k - 1][i] << 8) ^ t[0][t[k - 1][i] >> 56];
+        }
+    }
+    std::array<std::array<Reg, 256>, 16> out{};
+    for (int k = 0; k < 16; k++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            out[k][i] = (Reg)(t[k][i] >> (64 - 8 * sizeof(Reg))); // the bits below the degree are zero
+        }
+    }
+    return out;
+}
+
+/// 1-indexed codeword position of every data bit.
+template <size_t DataBits>
+constexpr std::array<size_t, DataBits>
+FixedDataPositions()
+{
+    std::array<size_t, DataBits> pos{};
+    size_t p = 1;
+    for (size_t c = 0; c < DataBits; c++, p++)
+    {
+        while ((p & (p - 1)) == 0)
+        {
+            p++;
+        }
+        pos[c] = p;
+    }
+    return pos;
+}
+
+/**
+ * \brief Hamming code of Hamming.h for rows of exactly M characters.
+ *
+ * Blocks of at least Hamming::kSliceRows rows are bitsliced as in
+ * Hamming, but every check and syndrome word is a fold over the columns
+ * it covers, picked at compile time, so there are no loops or branches
+ * on the code structure left. Smaller blocks go row by row: a row is held
+ * as kWords left-aligned 64-bit words, data bits reach their codeword
+ * positions through kMoves shift-and-mask moves, none of which crosses a
+ * word boundary on either side, and check bit i is the parity of the
+ * codeword under kMask[i].
+ */
+template <size_t M>
+class FixedHamming
+{
+  public:
+    static constexpr size_t kDataBits = 8 * M;
+    static constexpr size_t kCheckBits = FixedCheckBits(kDataBits);
+    static constexpr size_t kCodeBits = kDataBits + kCheckBits;
+    static constexpr size_t kWords = (kCodeBits + 63) / 64;
+    static constexpr size_t kDataWords = (kDataBits + 63) / 64;
+
+    static constexpr size_t kMoves = FixedMoveCount(kDataBits);
+    static constexpr std::array<FixedMove, kMoves> kMove = FixedMoves<kDataBits, kMoves>();
+    static constexpr std::array<std::array<uint64_t, kWords>, kCheckBits> kMask = FixedMasks<kCodeBits, kWords, kCheckBits>();
+    static constexpr std::array<FixedFlip, (size_t(1) << kCheckBits)> kFlip = FixedFlips<kCodeBits, kCheckBits>();
+    static constexpr std::array<size_t, kDataBits> kDataPos = FixedDataPositions<kDataBits>();
+
+    /// Bitsliced encode of 64 * W rows per group, slice layout as Hamming::EncodeSliced.
+    template <int W>
+    __attribute__((always_inline)) static inline void EncodeSliced(const BitBlock& data, BitBlock& code)
+    {
+        alignas(32) uint64_t in[kDataBits * W];
+        alignas(32) uint64_t out[kCodeBits * W];
+        for (size_t g = 0; g < data.Rows(); g += 64 * W)
+        {
+            for (int w = 0; w < W; w++)
+            {
+                size_t first = g + 64 * w;
+                size_t nr = first >= data.Rows() ? 0 : std::min<size_t>(64, data.Rows() - first);
+                LoadSlices(data.Bits(), first * kDataBits, nr, kDataBits, in + w, W);
+            }
+            for (size_t c = 0; c < kDataBits; c++)
+            {
+                for (int w = 0; w < W; w++)
+                {
+                    out[(kDataPos[c] - 1) * W + w] = in[c * W + w];
+                }
+            }
+            CheckSlices<W>(in, out, std::make_index_sequence<kCheckBits>());
+            for (int w = 0; w < W; w++)
+            {
+                size_t first = g + 64 * w;
+                if (first < data.Rows())
+                {
+                    StoreSlices(out + w, W, std::min<size_t>(64, data.Rows() - first), kCodeBits, code.Bits(),
+                                first * kCodeBits);
+                }
+            }
+        }
+    }
+
+    /// Bitsliced correct of 64 * W rows per group; returns rows with a non-zero syndrome.
+    template <int W>
+    __attribute__((always_inline)) static inline size_t CorrectSliced(BitBlock& code)
+    {
+        size_t fixed = 0;
+        alignas(32) uint64_t slices[kCodeBits * W];
+        alignas(32) uint64_t syndrome[kCheckBits * W];
+        for (size_t g = 0; g < code.Rows(); g += 64 * W)
+        {
+            for (int w = 0; w < W; w++)
+            {
+                size_t first = g + 64 * w;
+                size_t nr = first >= code.Rows() ? 0 : std::min<size_t>(64, code.Rows() - first);
+                LoadSlices(code.Bits(), first * kCodeBits, nr, kCodeBits, slices + w, W);
+            }
+            SyndromeSlices<W>(slices, syndrome, std::make_index_sequence<kCheckBits>());
+            for (int w = 0; w < W; w++)
+            {
+                uint64_t bad = 0;
+                for (size_t i = 0; i < kCheckBits; i++)
+                {
+                    bad |= syndrome[i * W + w];
+                }
+                while (bad)
+                {
+                    unsigned row = __builtin_clzll(bad); // row i sits at bit 63 - i
+                    size_t s = 0;
+                    for (size_t i = 0; i < kCheckBits; i++)
+                    {
+                        s |= ((syndrome[i * W + w] >> (63 - row)) & 1) << i;
+                    }
+                    if (s <= kCodeBits)
+                    {
+                        code.Bits().Flip((g + 64 * w + row) * kCodeBits + s - 1);
+                    }
+                    fixed++;
+                    bad &= ~(1ULL << (63 - row));
+                }
+            }
+        }
+        return fixed;
+    }
+
+    static void EncodeRow(const BitVec& data, size_t in, BitVec& code, size_t out)
+    {
+        uint64_t d[kDataWords];
+        for (size_t k = 0; k < kDataWords; k++)
+        {
+            unsigned len = Len(kDataBits, k);
+            d[k] = data.GetBits(in + 64 * k, len) << (64 - len);
+        }
+        uint64_t c[kWords] = {};
+        for (size_t i = 0; i < kMoves; i++)
+        {
+            const FixedMove& mv = kMove[i];
+            uint64_t v = (d[mv.src / 64] << (mv.src % 64)) >> (64 - mv.len);
+            c[mv.dst / 64] |= v << (64 - mv.dst % 64 - mv.len);
+        }
+        for (size_t i = 0; i < kCheckBits; i++)
+        {
+            size_t col = (size_t(1) << i) - 1;
+            c[col / 64] |= Parity(c, i) << (63 - col % 64);
+        }
+        for (size_t k = 0; k < kWords; k++)
+        {
+            unsigned len = Len(kCodeBits, k);
+            code.XorBits(out + 64 * k, len, c[k] >> (64 - len)); // out is zeroed
+        }
+    }
+
+    /// Syndrome of the codeword at bit \p pos, flipping the bit it names; true if non-zero.
+    static bool CorrectRow(BitVec& code, size_t pos)
+    {
+        uint64_t c[kWords];
+        for (size_t k = 0; k < kWords; k++)
+        {
+            unsigned len = Len(kCodeBits, k);
+            c[k] = code.GetBits(pos + 64 * k, len) << (64 - len);
+        }
+        size_t s = 0;
+        for (size_t i = 0; i < kCheckBits; i++)
+        {
+            s |= Parity(c, i) << i;
+        }
+        if (s == 0)
+        {
+            return false;
+        }
+        const FixedFlip& f = kFlip[s];
+        if (f.mask)
+        {
+            unsigned len = Len(kCodeBits, f.word);
+            code.XorBits(pos + 64 * f.word, len, f.mask >> (64 - len));
+        }
+        return true;
+    }
+
+  private:
+    template <int W, size_t... I>
+    __attribute__((always_inline)) static inline void CheckSlices(const uint64_t* in, uint64_t* out,
+                                                                  std::index_sequence<I...>)
+    {
+        (CheckSlice<W, I>(in, out, std::make_index_sequence<kDataBits>()), ...);
+    }
+
+    /// Check bit I of every row: XOR of the data slices whose position has bit I set.
+    template <int W, size_t I, size_t... C>
+    __attribute__((always_inline)) static inline void CheckSlice(const uint64_t* in, uint64_t* out,
+                                                                 std::index_sequence<C...>)
+    {
+        for (int w = 0; w < W; w++)
+        {
+            uint64_t x = 0;
+            ((x ^= ((kDataPos[C] >> I) & 1) ? in[C * W + w] : 0), ...);
+            out[((size_t(1) << I) - 1) * W + w] = x;
+        }
+    }
+
+    template <int W, size_t... I>
+    __attribute__((always_inline)) static inline void SyndromeSlices(const uint64_t* slices, uint64_t* syndrome,
+                                                                     std::index_sequence<I...>)
+    {
+        (SyndromeSlice<W, I>(slices, syndrome, std::make_index_sequence<kCodeBits>()), ...);
+    }
+
+    /// Syndrome bit I of every row: XOR of the codeword slices whose position has bit I set.
+    template <int W, size_t I, size_t... C>
+    __attribute__((always_inline)) static inline void SyndromeSlice(const uint64_t* slices, uint64_t* syndrome,
+                                                                    std::index_sequence<C...>)
+    {
+        for (int w = 0; w < W; w++)
+        {
+            uint64_t x = 0;
+            ((x ^= (((C + 1) >> I) & 1) ? slices[C * W + w] : 0), ...);
+            syndrome[I * W + w] = x;
+        }
+    }
+
+    /// Valid bits in word \p k of an \p n bit row.
+    static constexpr unsigned Len(size_t n, size_t k)
+    {
+        return n - 64 * k < 64 ? n - 64 * k : 64;
+    }
+
+    static size_t Parity(const uint64_t* c, size_t i)
+    {
+        size_t ones = 0;
+        for (size_t k = 0; k < kWords; k++)
+        {
+            ones += __builtin_popcountll(c[k] & kMask[i][k]);
+        }
+        return ones & 1;
+    }
+};
+
+/**
+ * \brief CRC of CrcEngine for one generator, with constexpr slice tables.
+ * \tparam Poly low \p Degree coefficients of G. \tparam Degree 1..64.
+ *
+ * Generators of degree 32 or less keep the register and the tables in
+ * 32 bits, which halves the table footprint in the cache.
+ */
+template <uint64_t Poly, unsigned Degree>
+class FixedCrc
+{
+  public:
+    static_assert(Degree >= 1 && Degree <= 64, "degree must be 1..64");
+
+    typedef typename std::conditional<(Degree <= 32), uint32_t, uint64_t>::type Reg;
+    static constexpr unsigned kRegBits = 8 * sizeof(Reg);
+    static constexpr Reg kTop = Reg(1) << (kRegBits - 1);
+    static constexpr Reg kPoly = (Reg)(Poly << (kRegBits - Degree)); //!< Left-aligned in Reg.
+    static constexpr std::array<std::array<Reg, 256>, 16> kTable = FixedCrcTables<Reg, (Poly << (64 - Degree))>();
+
+    /// Same as CrcEngine::ComputeWords.
+    static uint64_t ComputeWords(const uint64_t* words, size_t nbits)
+    {
+        Reg reg = 0;
+        size_t n = nbits / 64;
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2)
+        {
+            reg = Slice16(((uint64_t)reg << (64 - kRegBits)) ^ words[i], words[i + 1]);
+        }
+        if (i < n)
+        {
+            reg = Slice8(((uint64_t)reg << (64 - kRegBits)) ^ words[i++]);
+        }
+        unsigned rest = nbits % 64;
+        if (rest)
+        {
+            uint64_t w = words[i];
+            for (; rest >= 8; rest -= 8, w <<= 8)
+            {
+                reg = (Reg)(reg << 8) ^ kTable[0][((reg >> (kRegBits - 8)) ^ (w >> 56)) & 0xff];
+            }
+            for (unsigned b = 0; b < rest; b++, w <<= 1)
+            {
+                reg ^= (w >> 63) ? kTop : 0;
+                reg = (reg & kTop) ? (Reg)(reg << 1) ^ kPoly : (Reg)(reg << 1);
+            }
+        }
+        return reg >> (kRegBits - Degree);
+    }
+
+  private:
+    static Reg Slice8(uint64_t x)
+    {
+        return kTable[7][x >> 56] ^ kTable[6][(x >> 48) & 0xff] ^
+               kTable[5][(x >> 40) & 0xff] ^ kTable[4][(x >> 32) & 0xff] ^
+               kTable[3][(x >> 24) & 0xff] ^ kTable[2][(x >> 16) & 0xff] ^
+               kTable[1][(x >> 8) & 0xff] ^ kTable[0][x & 0xff];
+    }
+
+    static Reg Slice16(uint64_t x, uint64_t y)
+    {
+        return kTable[15][x >> 56] ^ kTable[14][(x >> 48) & 0xff] ^
+               kTable[13][(x >> 40) & 0xff] ^ kTable[12][(x >> 32) & 0xff] ^
+               kTable[11][(x >> 24) & 0xff] ^ kTable[10][(x >> 16) & 0xff] ^
+               kTable[9][(x >> 8) & 0xff] ^ kTable[8][x & 0xff] ^
+               kTable[7][y >> 56] ^ kTable[6][(y >> 48) & 0xff] ^
+               kTable[5][(y >> 40) & 0xff] ^ kTable[4][(y >> 32) & 0xff] ^
+               kTable[3][(y >> 24) & 0xff] ^ kTable[2][(y >> 16) & 0xff] ^
+               kTable[1][(y >> 8) & 0xff] ^ kTable[0][y & 0xff];
+    }
+};
+
+/// Codec kernel for m = M and the generator (Poly, Degree).
+template <size_t M, uint64_t Poly, unsigned Degree>
+class FixedKernel : public CodecKernel
+{
+  public:
+    typedef FixedHamming<M> Code;
+
+    void Encode(const BitBlock& data, BitBlock& code) const override
+    {
+        if (data.Rows() >= Hamming::kSliceRows)
+        {
+            if (CpuHasAvx2())
+            {
+                EncodeSliced256(data, code);
+            }
+            else
+            {
+                Code::template EncodeSliced<1>(data, code);
+            }
+            return;
+        }
+        for (size_t r = 0; r < data.Rows(); r++)
+        {
+            Code::EncodeRow(data.Bits(), r * Code::kDataBits, code.Bits(), r * Code::kCodeBits);
+        }
+    }
+
+    size_t Correct(BitBlock& code) const override
+    {
+        if (code.Rows() >= Hamming::kSliceRows)
+        {
+            return CpuHasAvx2() ? CorrectSliced256(code) : Code::template CorrectSliced<1>(code);
+        }
+        size_t fixed = 0;
+        for (size_t r = 0; r < code.Rows(); r++)
+        {
+            fixed += Code::CorrectRow(code.Bits(), r * Code::kCodeBits);
+        }
+        return fixed;
+    }
+
+    uint64_t Checksum(const uint64_t* words, size_t nbits) const override
+    {
+        return FixedCrc<Poly, Degree>::ComputeWords(words, nbits);
+    }
+
+  private:
+#ifdef TRANSPOSE_X86
+    __attribute__((target("avx2"))) static void EncodeSliced256(const BitBlock& data, BitBlock& code)
+    {
+        Code::template EncodeSliced<4>(data, code);
+    }
+
+    __attribute__((target("avx2"))) static size_t CorrectSliced256(BitBlock& code)
+    {
+        return Code::template CorrectSliced<4>(code);
+    }
+#else
+    static void EncodeSliced256(const BitBlock& data, BitBlock& code)
+    {
+        Code::template EncodeSliced<1>(data, code);
+    }
+
+    static size_t CorrectSliced256(BitBlock& code)
+    {
+        return Code::template CorrectSliced<1>(code);
+    }
+#endif
+};
+
+/**
+ * \brief The specialized kernel for (m, generator), or nullptr if none is compiled in.
+ * \param poly low \p degree coefficients of the generator, as CrcEngine::Poly.
+ *
+ * Compiled in: m = 1, 2, 4, 8 with CRC-8 (0x07), CRC-16-CCITT (0x1021)
+ * and CRC-32 (0x04C11DB7).
+ */
+inline std::shared_ptr<const CodecKernel>
+FindKernel(size_t m, uint64_t poly, unsigned degree)
+{
+    struct Entry
+    {
+        size_t m;
+        uint64_t poly;
+        unsigned degree;
+        std::shared_ptr<const CodecKernel> kernel;
+    };
+#define FIXED_KERNEL(m, poly, degree) {m, poly, degree, std::make_shared<FixedKernel<m, poly, degree>>()}
+#define FIXED_KERNELS(m) FIXED_KERNEL(m, 0x07, 8), FIXED_KERNEL(m, 0x1021, 16), FIXED_KERNEL(m, 0x04C11DB7, 32)
+    static const Entry entries[] = {FIXED_KERNELS(1), FIXED_KERNELS(2), FIXED_KERNELS(4), FIXED_KERNELS(8)};
+#undef FIXED_KERNELS
+#undef FIXED_KERNEL
+    for (const Entry& e : entries)
+    {
+        if (e.m == m && e.poly == poly && e.degree == degree)
+        {
+            return e.kernel;
+        }
+    }
+    return nullptr;
+}
+
+#endif /* FIXED_CODEC_H */
@@ -0,0 +1,416 @@
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include "bitblock.h"
+#include "channel.h"
+#include "codec.h"
+#include "reference.h"
+#include "rng.h"
+#include "span_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// One randomized input of the differential fuzzer.
+struct FuzzCase
+{
+    std::string data;
+    size_t m;
+    double p;
+    std::string generator;
+    uint64_t seed; //!< Channel stream.
+};
+
+/**
+ * \brief Case \p index of the run keyed by \p seed.
+ *
+ * Case i depends only on (seed, i), so a failure can be replayed alone.
+ * The mix leans towards the edges: the row widths and generators that
+ * have compile-time kernels next to arbitrary ones, generators with
+ * leading zeros or of degree 0 and 64, every byte value, and now and then
+ * a message long enough for the bitsliced and AVX2 paths (64 and 256 rows).
+ */
+inline FuzzCase
+MakeFuzzCase(uint64_t seed, uint64_t index, size_t maxLength)
+{
+    Philox4x32 rng(seed, index);
+    FuzzCase c;
+    static const size_t kWidths[] = {1, 2, 4, 8};
+    c.m = rng() % 2 ? kWidths[rng() % 4] : 1 + rng() % 16;
+
+    static const char* const kGenerators[] = {"1", "11", "100000111", "10001000000100001",
+                                              "100000100110000010001110110110111"};
+    switch (rng() % 4)
+    {
+    case 0:
+        c.generator = kGenerators[rng() % 5];
+        break;
+    case 1: // degree 64
+        c.generator = "1";
+        for (int i = 0; i < 64; i++)
+        {
+            c.generator += (char)('0' + rng() % 2);
+        }
+        break;
+    default:
+        c.generator = std::string(rng() % 3, '0') + "1";
+        for (size_t i = 0, d = rng() % 40; i < d; i++)
+        {
+            c.generator += (char)('0' + rng() % 2);
+        }
+    }
+
+    static const double kPs[] = {0, 0, 1e-3, 1e-2, 0.05, 0.2, 0.5, 1};
+    c.p = kPs[rng() % 8];
+
+    size_t length = 1 + rng() % maxLength;
+    if (rng() % 8 == 0)
+    {
+        length = c.m * (60 + rng() % 260); // around and past the 64- and 256-row thresholds
+    }
+    bool printable = rng() % 2;
+    c.data.resize(length);
+    for (char& ch : c.data)
+    {
+        ch = printable ? (char)(32 + rng() % 95) : (char)rng();
+    }
+    c.seed = rng();
+    return c;
+}
+
+/// Rows of a block as '0'/'1' strings.
+inline std::vector<std::string>
+FuzzRows(const BitBlock& block)
+{
+    std::vector<std::string> rows;
+    for (size_t r = 0; r < block.Rows(); r++)
+    {
+        rows.push_back(block.RowString(r));
+    }
+    return rows;
+}
+
+/**
+ * \brief Run one case through Codec (with and without compile-time kernels),
+ * Codec::Receive and SpanCodec, comparing every stage with ReferenceCodec.
+ *
+ * The channel is random, so it runs once and both sides receive the same
+ * frame.
+ * \return the first stage that differs, or an empty string.
+ */
+inline std::string
+FuzzOne(const FuzzCase& c)
+{
+    ReferenceCodec ref(c.m, c.generator);
+    std::string padded = ref.Pad(c.data);
+    std::vector<std::string> dataRows = ref.DataBlock(padded);
+    std::vector<std::string> codeRows;
+    for (const std::string& row : dataRows)
+    {
+        codeRows.push_back(ref.EncodeRow(row));
+    }
+    std::string sent = ref.AppendCrc(ReferenceCodec::Serialize(codeRows));
+
+    for (bool specialize : {false, true})
+    {
+        std::string tag = specialize ? " (kernel)" : " (generic)";
+        Codec codec(c.m, c.generator, specialize);
+        if (codec.Pad(c.data) != padded)
+        {
+            return "pad" + tag;
+        }
+        BitBlock block = codec.DataBlock(padded);
+        if (FuzzRows(block) != dataRows)
+        {
+            return "data block" + tag;
+        }
+        BitBlock encoded = codec.AddCheckBits(block);
+        if (FuzzRows(encoded) != codeRows)
+        {
+            return "hamming encode" + tag;
+        }
+        BitVec frame = codec.AppendCrc(codec.Serialize(encoded));
+        if (frame.ToString() != sent)
+        {
+            return "serialize + crc" + tag;
+        }
+
+        Philox4x32 noise(c.seed, 0);
+        BitFlipChannel(c.p).Apply(frame, noise);
+        std::string received = frame.ToString();
+        bool refOk = ref.CheckCrc(received);
+        if (codec.CheckCrc(frame) != refOk)
+        {
+            return "crc check" + tag;
+        }
+        std::vector<std::string> rxRows = ref.Deserialize(received);
+        BitBlock rxBlock = codec.Deserialize(frame);
+        if (FuzzRows(rxBlock) != rxRows)
+        {
+            return "deserialize" + tag;
+        }
+        size_t refCorrected = 0;
+        std::vector<std::string> outRows;
+        for (std::string& row : rxRows)
+        {
+            refCorrected += ref.CorrectRow(row);
+            outRows.push_back(ReferenceCodec::StripRow(row));
+        }
+        if (codec.CorrectRows(rxBlock) != refCorrected || FuzzRows(rxBlock) != rxRows)
+        {
+            return "hamming correct" + tag;
+        }
+        BitBlock out = codec.RemoveCheckBits(rxBlock);
+        if (FuzzRows(out) != outRows)
+        {
+            return "strip check bits" + tag;
+        }
+        std::string text = ReferenceCodec::Ascii(outRows);
+        if (Codec::Ascii(out) != text)
+        {
+            return "ascii" + tag;
+        }
+
+        std::string fused(codec.FrameRows(frame) * c.m, '\0');
+        ReceiveResult rx = codec.Receive(frame, &fused[0]);
+        if (rx.crcOk != refOk || rx.rowsCorrected != refCorrected || fused != text)
+        {
+            return "fused receive" + tag;
+        }
+
+        SpanCodec api(codec);
+        std::vector<uint64_t> words(api.FrameWords(c.data.size()));
+        size_t nbits = api.Encode(Span<const char>(c.data.data(), c.data.size()), words);
+        BitSpan view(words.data(), nbits);
+        if (nbits != sent.size())
+        {
+            return "span encode" + tag;
+        }
+        for (size_t i = 0; i < nbits; i++)
+        {
+            if (view.Get(i) != (sent[i] == '1'))
+            {
+                return "span encode" + tag;
+            }
+        }
+        std::copy(frame.Words(), frame.Words() + frame.NumWords(), words.begin());
+        std::vector<char> decoded(api.DecodedBytes(nbits));
+        rx = api.Decode(words, nbits, decoded);
+        if (rx.crcOk != refOk || std::string(decoded.begin(), decoded.end()) != text)
+        {
+            return "span decode" + tag;
+        }
+    }
+    return "";
+}
+
+/**
+ * \brief Run one case through Codec with Reed-Solomon rows.
+ *
+ * The parity count is derived from the case's channel stream, so cases
+ * keep their Hamming inputs. Encoding is compared with
+ * ReferenceReedSolomon; after the channel, the chained stages, the fused
+ * receiver and SpanCodec must agree with each other, and every row that
+ * arrived with at most t wrong bytes must come out right. The region
+ * kernels in use are compared with the scalar ones on the message bytes.
+ * \return the first check that fails, or an empty string.
+ */
+inline std::string
+FuzzReedSolomon(const FuzzCase& c)
+{
+    if (c.m >= 255)
+    {
+        return "";
+    }
+    size_t parity = 1 + c.seed % std::min<size_t>(32, 255 - c.m);
+    Codec codec(c.m, c.generator, true, parity);
+    const ReedSolomon& rs = *codec.GetReedSolomon();
+
+    std::vector<uint8_t> fast(c.data.begin(), c.data.end());
+    std::vector<uint8_t> slow = fast;
+    std::vector<uint8_t> src(fast.rbegin(), fast.rend());
+    Gf256::MulTable table = Gf256::Table((uint8_t)(c.seed >> 8));
+    GfRegionBest().mulAdd(fast.data(), src.data(), fast.size(), table);
+    GfMulAddScalar(slow.data(), src.data(), slow.size(), table);
+    GfRegionBest().horner(fast.data(), src.data(), fast.size(), table);
+    GfHornerScalar(slow.data(), src.data(), slow.size(), table);
+    if (fast != slow)
+    {
+        return std::string("gf region kernels (") + GfRegionBest().name + ")";
+    }
+
+    std::string padded = codec.Pad(c.data);
+    BitBlock block = codec.DataBlock(padded);
+    BitBlock encoded = codec.AddCheckBits(block);
+    ReferenceReedSolomon ref(parity);
+    for (size_t r = 0; r < block.Rows(); r++)
+    {
+        if (encoded.RowString(r) != ref.EncodeRow(block.RowString(r)))
+        {
+            return "rs encode";
+        }
+    }
+    BitVec frame = codec.AppendCrc(codec.Serialize(encoded));
+    Philox4x32 noise(c.seed, 0);
+    Channel(c.p).Apply(frame, noise);
+
+    BitBlock rxBlock = codec.Deserialize(frame);
+    std::vector<size_t> wrong(rxBlock.Rows());
+    for (size_t r = 0; r < rxBlock.Rows(); r++)
+    {
+        for (size_t j = 0; j < rs.CodeBytes(); j++)
+        {
+            size_t pos = r * rs.CodeBits() + 8 * j;
+            wrong[r] += rxBlock.Bits().GetBits(pos, 8) != encoded.Bits().GetBits(pos, 8);
+        }
+    }
+    size_t corrected = codec.CorrectRows(rxBlock);
+    std::string text = Codec::Ascii(codec.RemoveCheckBits(rxBlock));
+    for (size_t r = 0; r < wrong.size(); r++)
+    {
+        if (wrong[r] <= rs.Correctable() && text.compare(r * c.m, c.m, padded, r * c.m, c.m) != 0)
+        {
+            return "rs correct";
+        }
+    }
+
+    std::string fused(codec.FrameRows(frame) * c.m, '\0');
+    ReceiveResult rx = codec.Receive(frame, &fused[0]);
+    bool crcOk = codec.CheckCrc(frame);
+    if (rx.crcOk != crcOk || rx.rowsCorrected != corrected || fused != text)
+    {
+        return "rs fused receive";
+    }
+    SpanCodec api(codec);
+    std::vector<uint64_t> words(api.FrameWords(c.data.size()));
+    size_t nbits = api.Encode(Span<const char>(c.data.data(), c.data.size()), words);
+    BitVec sent = codec.AppendCrc(codec.Serialize(encoded));
+    if (nbits != sent.Size() || !std::equal(sent.Words(), sent.Words() + sent.NumWords(), words.begin()))
+    {
+        return "rs span encode";
+    }
+    std::copy(frame.Words(), frame.Words() + frame.NumWords(), words.begin());
+    std::vector<char> decoded(api.DecodedBytes(nbits));
+    rx = api.Decode(words, nbits, decoded);
+    if (rx.crcOk != crcOk || std::string(decoded.begin(), decoded.end()) != text)
+    {
+        return "rs span decode";
+    }
+    return "";
+}
+
+/**
+ * \brief Check that a random channel model delivers its mean bit error rate.
+ *
+ * The model, its parameters and p in [0.01, 0.45] come from the case's
+ * channel stream: i.i.d., Gilbert-Elliott with state error rates around p
+ * and a burst from the shortest allowed upwards, or fixed-length bursts.
+ * The channel runs over 2^16 zero bits; the toggled share must lie within
+ * six standard deviations of p, counting the bits a burst or a bad-state
+ * visit correlates, and match the flips the model reports. A
+ * Gilbert-Elliott burst below the shortest must be rejected.
+ * \return the first check that fails, or an empty string.
+ */
+inline std::string
+FuzzChannel(const FuzzCase& c)
+{
+    Philox4x32 rng(c.seed, 1);
+    double p = 0.01 + 0.44 * UniformOpen0(rng);
+    double span = 1; // bits over which the toggles are correlated
+    char spec[128];
+    switch (rng() % 3)
+    {
+    case 0:
+        std::snprintf(spec, sizeof(spec), "iid");
+        break;
+    case 1: {
+        double bad = p + (1 - p) * UniformOpen0(rng);
+        double good = rng() % 2 ? p * UniformOpen0(rng) : 0;
+        double share = (p - good) / (bad - good);
+        double shortest = std::max(1.0, share < 1 ? share / (1 - share) : 1);
+        double burst = shortest * (1 + 4 * UniformOpen0(rng));
+        if (shortest > 1.01)
+        {
+            std::snprintf(spec, sizeof(spec), "ge:%.17g,%.17g,%.17g", shortest * 0.99, bad, good);
+            try
+            {
+                Channel::Parse(spec, p);
+                return std::string("channel ") + spec + " accepted below the shortest burst";
+            }
+            catch (const std::invalid_argument&)
+            {
+            }
+        }
+        std::snprintf(spec, sizeof(spec), "ge:%.17g,%.17g,%.17g", burst, bad, good);
+        span = 2 * (burst + burst * (1 - share) / share);
+        break;
+    }
+    default: {
+        size_t length = 1 + rng() % 64;
+        double perBurst = length <= 2 ? length : (length + 2) / 2.0;
+        p = std::min(p, perBurst / length);
+        std::snprintf(spec, sizeof(spec), "burst:%zu", length);
+        span = 2.0 * length;
+        break;
+    }
+    }
+    const size_t nbits = size_t(1) << 16;
+    BitVec frame(nbits);
+    Philox4x32 noise(c.seed, 2);
+    size_t flips = Channel::Parse(spec, p).Apply(frame, noise);
+    size_t toggled = 0;
+    for (size_t w = 0; w < frame.NumWords(); w++)
+    {
+        toggled += __builtin_popcountll(frame.Words()[w]);
+    }
+    double sigma = std::sqrt(p * (1 - p) * span / nbits);
+    if (toggled != flips || std::fabs((double)toggled / nbits - p) > 6 * sigma)
+    {
+        char msg[256];
+        std::snprintf(msg, sizeof(msg), "channel %s at p %g (measured %g)", spec, p, (double)toggled / nbits);
+        return msg;
+    }
+    return "";
+}
+
+/**
+ * \brief Fuzz cases [first, first + count) of the run keyed by \p seed.
+ *
+ * Every mismatch is logged to \p log with the case and the command that
+ * replays it alone.
+ * \return number of failing cases.
+ */
+inline size_t
+RunFuzz(uint64_t seed, uint64_t first, uint64_t count, size_t maxLength, FILE* log)
+{
+    size_t failures = 0;
+    for (uint64_t i = first; i < first + count; i++)
+    {
+        FuzzCase c = MakeFuzzCase(seed, i, maxLength);
+        std::string stage = FuzzOne(c);
+        if (stage.empty())
+        {
+            stage = FuzzReedSolomon(c);
+        }
+        if (stage.empty())
+        {
+            stage = FuzzChannel(c);
+        }
+        if (!stage.empty())
+        {
+            failures++;
+            std::fprintf(log, "case %llu: %s differs (length %zu, m %zu, p %g, generator %s)\n"
+                              "  replay: --fuzz --seed=%llu --fuzz-case=%llu --length=%zu\n",
+                         (unsigned long long)i, stage.c_str(), c.data.size(), c.m, c.p, c.generator.c_str(),
+                         (unsigned long long)seed, (unsigned long long)i, maxLength);
+        }
+    }
+    return failures;
+}
+
+#endif /* FUZZ_H */
@@ -0,0 +1,238 @@
+#ifndef GF256_H
+#define GF256_H
+
+#include "transpose.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief Arithmetic in GF(2^8) modulo x^8 + x^4 + x^3 + x^2 + 1 (0x11D), generator alpha = 2.
+ *
+ * Single products go through log and antilog tables. Multiplying a whole
+ * region by one constant goes through two 16-entry tables instead, one
+ * for each nibble of the other factor: c * x = lo[x & 15] ^ hi[x >> 4],
+ * because multiplication by c is linear over GF(2). Sixteen entries are
+ * exactly one PSHUFB, so SSSE3 multiplies 16 bytes and AVX2 32 bytes per
+ * shuffle pair.
+ */
+class Gf256
+{
+  public:
+    /// Split-nibble product table of one constant.
+    struct MulTable
+    {
+        alignas(16) uint8_t lo[16]; //!< c * x for x = 0..15.
+        alignas(16) uint8_t hi[16]; //!< c * (x << 4) for x = 0..15.
+    };
+
+    static uint8_t Exp(size_t i)
+    {
+        return Tables().exp[i % 255];
+    }
+
+    /// Discrete log of a non-zero element.
+    static size_t Log(uint8_t a)
+    {
+        return Tables().log[a];
+    }
+
+    static uint8_t Mul(uint8_t a, uint8_t b)
+    {
+        if (a == 0 || b == 0)
+        {
+            return 0;
+        }
+        return Tables().exp[Tables().log[a] + Tables().log[b]];
+    }
+
+    /// Quotient a / b, b non-zero.
+    static uint8_t Div(uint8_t a, uint8_t b)
+    {
+        if (a == 0)
+        {
+            return 0;
+        }
+        return Tables().exp[Tables().log[a] + 255 - Tables().log[b]];
+    }
+
+    static MulTable Table(uint8_t c)
+    {
+        MulTable t;
+        for (int x = 0; x < 16; x++)
+        {
+            t.lo[x] = Mul(c, (uint8_t)x);
+            t.hi[x] = Mul(c, (uint8_t)(x << 4));
+        }
+        return t;
+    }
+
+  private:
+    struct LogTables
+    {
+        uint8_t exp[512]; //!< alpha^i, doubled so that sums of two logs need no reduction.
+        uint8_t log[256]; //!< log[alpha^i] = i; log[0] unused.
+
+        LogTables()
+        {
+            unsigned x = 1;
+            for (int i = 0; i < 255; i++)
+            {
+                exp[i] = exp[i + 255] = (uint8_t)x;
+                log[x] = (uint8_t)i;
+                x <<= 1;
+                if (x & 0x100)
+                {
+                    x ^= 0x11D;
+                }
+            }
+            exp[510] = exp[511] = exp[0];
+            log[0] = 0;
+        }
+    };
+
+    static const LogTables& Tables()
+    {
+        static const LogTables tables;
+        return tables;
+    }
+};
+
+/**
+ * \brief Region kernels over n bytes with one constant, given by its table.
+ *
+ * MulAdd: dst[i] ^= c * src[i], the step of the systematic encoder.
+ * Horner: acc[i] = c * acc[i] ^ src[i], one step of evaluating a
+ * polynomial at the point c, as for syndromes.
+ */
+struct GfRegionKernels
+{
+    void (*mulAdd)(uint8_t* dst, const uint8_t* src, size_t n, const Gf256::MulTable& t);
+    void (*horner)(uint8_t* acc, const uint8_t* src, size_t n, const Gf256::MulTable& t);
+    const char* name;
+};
+
+inline void
+GfMulAddScalar(uint8_t* dst, const uint8_t* src, size_t n, const Gf256::MulTable& t)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] ^= t.lo[src[i] & 15] ^ t.hi[src[i] >> 4];
+    }
+}
+
+inline void
+GfHornerScalar(uint8_t* acc, const uint8_t* src, size_t n, const Gf256::MulTable& t)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        acc[i] = t.lo[acc[i] & 15] ^ t.hi[acc[i] >> 4] ^ src[i];
+    }
+}
+
+#ifdef TRANSPOSE_X86
+/// c * x for 16 bytes x: two shuffles into the nibble tables.
+__attribute__((target("ssse3"))) inline __m128i
+GfMul128(__m128i x, __m128i lo, __m128i hi)
+{
+    __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(x, nibble));
+    __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(x, 4), nibble));
+    return _mm_xor_si128(l, h);
+}
+
+__attribute__((target("ssse3"))) inline void
+GfMulAddSsse3(uint8_t* dst, const uint8_t* src, size_t n, const Gf256::MulTable& t)
+{
+    __m128i lo = _mm_load_si128((const __m128i*)t.lo);
+    __m128i hi = _mm_load_si128((const __m128i*)t.hi);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i p = GfMul128(_mm_loadu_si128((const __m128i*)(src + i)), lo, hi);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(_mm_loadu_si128((const __m128i*)(dst + i)), p));
+    }
+    GfMulAddScalar(dst + i, src + i, n - i, t);
+}
+
+__attribute__((target("ssse3"))) inline void
+GfHornerSsse3(uint8_t* acc, const uint8_t* src, size_t n, const Gf256::MulTable& t)
+{
+    __m128i lo = _mm_load_si128((const __m128i*)t.lo);
+    __m128i hi = _mm_load_si128((const __m128i*)t.hi);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i p = GfMul128(_mm_loadu_si128((const __m128i*)(acc + i)), lo, hi);
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_xor_si128(p, _mm_loadu_si128((const __m128i*)(src + i))));
+    }
+    GfHornerScalar(acc + i, src + i, n - i, t);
+}
+
+/// c * x for 32 bytes x; the tables are repeated in both 128-bit lanes, as VPSHUFB works per lane.
+__attribute__((target("avx2"))) inline __m256i
+GfMul256(__m256i x, __m256i lo, __m256i hi)
+{
+    __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(x, nibble));
+    __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+    return _mm256_xor_si256(l, h);
+}
+
+__attribute__((target("avx2"))) inline void
+GfMulAddAvx2(uint8_t* dst, const uint8_t* src, size_t n, const Gf256::MulTable& t)
+{
+    __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)t.lo));
+    __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)t.hi));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i p = GfMul256(_mm256_loadu_si256((const __m256i*)(src + i)), lo, hi);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(dst + i)), p));
+    }
+    GfMulAddScalar(dst + i, src + i, n - i, t);
+}
+
+__attribute__((target("avx2"))) inline void
+GfHornerAvx2(uint8_t* acc, const uint8_t* src, size_t n, const Gf256::MulTable& t)
+{
+    __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)t.lo));
+    __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)t.hi));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i p = GfMul256(_mm256_loadu_si256((const __m256i*)(acc + i)), lo, hi);
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_xor_si256(p, _mm256_loadu_si256((const __m256i*)(src + i))));
+    }
+    GfHornerScalar(acc + i, src + i, n - i, t);
+}
+#endif
+
+inline GfRegionKernels
+GfRegionScalar()
+{
+    return {GfMulAddScalar, GfHornerScalar, "scalar"};
+}
+
+/// Best region kernels the running CPU supports, picked once.
+inline const GfRegionKernels&
+GfRegionBest()
+{
+    static const GfRegionKernels best = [] {
+#ifdef TRANSPOSE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return GfRegionKernels{GfMulAddAvx2, GfHornerAvx2, "avx2"};
+        }
+        if (__builtin_cpu_supports("ssse3"))
+        {
+            return GfRegionKernels{GfMulAddSsse3, GfHornerSsse3, "ssse3"};
+        }
+#endif
+        return GfRegionScalar();
+    }();
+    return best;
+}
+
+#endif /* GF256_H */
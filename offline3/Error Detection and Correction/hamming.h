@@ -0,0 +1,377 @@
+#ifndef HAMMING_H
+#define HAMMING_H
+
+#include "arena.h"
+#include "bitblock.h"
+#include "transpose.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Single-error-correcting Hamming code of figure 3-7 in Tanenbaum.
+ *
+ * A row of n data bits becomes a codeword of n + r bits. Positions are
+ * numbered from 1; positions 1, 2, 4, 8, ... hold even-parity check bits
+ * and the data bits fill the rest in order. Check bit 2^i covers every
+ * position whose number has bit i set, so the XOR of the positions of all
+ * set bits is zero for a valid codeword and names the flipped position
+ * otherwise.
+ *
+ * Rows are handled as packed bits: data moves between the runs of
+ * non-check positions (3, 5..7, 9..15, ...) up to 64 bits at a time and
+ * the parity is taken from the set bits of each 64-bit chunk.
+ *
+ * Blocks of at least kSliceRows rows are bitsliced instead: every row
+ * uses the same parity structure, so groups of 64 rows (256 with AVX2)
+ * are transposed so that one word holds the same column of all of them.
+ * A check bit or syndrome bit of the whole group is then a XOR of column
+ * words, and only rows with a non-zero syndrome are looked at one by one.
+ */
+class Hamming
+{
+  public:
+    /// \param dataBits number of data bits per row (8m for m characters).
+    explicit Hamming(size_t dataBits)
+        : m_dataBits(dataBits),
+          m_checkBits(CheckBitCount(dataBits))
+    {
+        size_t k = 0;
+        for (size_t p = 2; k < m_dataBits; p <<= 1)
+        {
+            size_t len = std::min(p - 1, m_dataBits - k);
+            m_runs.emplace_back(p, len); // positions p+1 .. p+len, i.e. 0-indexed from p
+            for (size_t i = 1; i <= len; i++)
+            {
+                m_dataPos.push_back(p + i);
+            }
+            k += len;
+        }
+    }
+
+    /// Blocks with at least this many rows take the bitsliced path.
+    static const size_t kSliceRows = 64;
+
+    /// Smallest r with 2^r >= n + r + 1.
+    static size_t CheckBitCount(size_t n)
+    {
+        size_t r = 0;
+        while ((size_t(1) << r) < n + r + 1)
+        {
+            r++;
+        }
+        return r;
+    }
+
+    /// True if 0-indexed column \p col of a codeword holds a check bit.
+    static bool IsCheckColumn(size_t col)
+    {
+        return ((col + 1) & col) == 0;
+    }
+
+    size_t DataBits() const
+    {
+        return m_dataBits;
+    }
+
+    size_t CheckBits() const
+    {
+        return m_checkBits;
+    }
+
+    size_t CodeBits() const
+    {
+        return m_dataBits + m_checkBits;
+    }
+
+    /// 1-indexed codeword position of every data bit, in data order.
+    const std::vector<size_t>& DataPositions() const
+    {
+        return m_dataPos;
+    }
+
+    /// Add check bits to every row of \p data.
+    BitBlock Encode(const BitBlock& data) const
+    {
+        BitBlock code;
+        Encode(data, code);
+        return code;
+    }
+
+    /// Encode into \p code, reusing its storage.
+    void Encode(const BitBlock& data, BitBlock& code) const
+    {
+        code.Reset(data.Rows(), CodeBits());
+        if (data.Rows() >= kSliceRows)
+        {
+            if (CpuHasAvx2())
+            {
+                EncodeSliced256(data, code);
+            }
+            else
+            {
+                EncodeSliced<1>(data, code);
+            }
+            return;
+        }
+        for (size_t r = 0; r < data.Rows(); r++)
+        {
+            EncodeRow(data.Bits(), r * m_dataBits, code.Bits(), r * CodeBits());
+        }
+    }
+
+    /**
+     * \brief Fix at most one flipped bit in every row of \p code, in place.
+     * \return number of rows whose syndrome was non-zero.
+     */
+    size_t Correct(BitBlock& code) const
+    {
+        if (code.Rows() >= kSliceRows)
+        {
+            return CpuHasAvx2() ? CorrectSliced256(code) : CorrectSliced<1>(code);
+        }
+        size_t fixed = 0;
+        for (size_t r = 0; r < code.Rows(); r++)
+        {
+            if (CorrectRow(code.Bits(), r * CodeBits()))
+            {
+                fixed++;
+            }
+        }
+        return fixed;
+    }
+
+    /**
+     * \brief Bitsliced encode, 64 * W rows per group.
+     *
+     * Slices are stored interleaved, word w of column c at c * W + w, so
+     * with W = 4 each column of 256 rows is one AVX2 register.
+     */
+    template <int W>
+    __attribute__((always_inline)) inline void EncodeSliced(const BitBlock& data, BitBlock& code) const
+    {
+        size_t n = CodeBits();
+        ArenaScope scope;
+        uint64_t* in = scope.Arena().Words(m_dataBits * W);
+        uint64_t* out = scope.Arena().Words(n * W);
+        for (size_t g = 0; g < data.Rows(); g += 64 * W)
+        {
+            for (int w = 0; w < W; w++)
+            {
+                size_t first = g + 64 * w;
+                size_t nr = first >= data.Rows() ? 0 : std::min<size_t>(64, data.Rows() - first);
+                LoadSlices(data.Bits(), first * m_dataBits, nr, m_dataBits, in + w, W);
+            }
+            std::fill(out, out + n * W, 0);
+            for (size_t c = 0; c < m_dataBits; c++)
+            {
+                size_t pos = m_dataPos[c];
+                uint64_t* dst = out + (pos - 1) * W;
+                const uint64_t* src = in + c * W;
+                for (int w = 0; w < W; w++)
+                {
+                    dst[w] = src[w];
+                }
+                for (size_t i = 0; i < m_checkBits; i++)
+                {
+                    if ((pos >> i) & 1)
+                    {
+                        uint64_t* check = out + ((size_t(1) << i) - 1) * W;
+                        for (int w = 0; w < W; w++)
+                        {
+                            check[w] ^= src[w];
+                        }
+                    }
+                }
+            }
+            for (int w = 0; w < W; w++)
+            {
+                size_t first = g + 64 * w;
+                if (first < data.Rows())
+                {
+                    size_t nr = std::min<size_t>(64, data.Rows() - first);
+                    StoreSlices(out + w, W, nr, n, code.Bits(), first * n);
+                }
+            }
+        }
+    }
+
+    /// Bitsliced correct, 64 * W rows per group. Bits are flipped directly in \p code.
+    template <int W>
+    __attribute__((always_inline)) inline size_t CorrectSliced(BitBlock& code) const
+    {
+        size_t n = CodeBits();
+        size_t fixed = 0;
+        ArenaScope scope;
+        uint64_t* slices = scope.Arena().Words(n * W);
+        uint64_t* syndrome = scope.Arena().Words(m_checkBits * W);
+        for (size_t g = 0; g < code.Rows(); g += 64 * W)
+        {
+            for (int w = 0; w < W; w++)
+            {
+                size_t first = g + 64 * w;
+                size_t nr = first >= code.Rows() ? 0 : std::min<size_t>(64, code.Rows() - first);
+                LoadSlices(code.Bits(), first * n, nr, n, slices + w, W);
+            }
+            std::fill(syndrome, syndrome + m_checkBits * W, 0);
+            for (size_t pos = 1; pos <= n; pos++)
+            {
+                const uint64_t* src = slices + (pos - 1) * W;
+                for (size_t i = 0; i < m_checkBits; i++)
+                {
+                    if ((pos >> i) & 1)
+                    {
+                        uint64_t* s = syndrome + i * W;
+                        for (int w = 0; w < W; w++)
+                        {
+                            s[w] ^= src[w];
+                        }
+                    }
+                }
+            }
+            for (int w = 0; w < W; w++)
+            {
+                uint64_t bad = 0;
+                for (size_t i = 0; i < m_checkBits; i++)
+                {
+                    bad |= syndrome[i * W + w];
+                }
+                while (bad)
+                {
+                    unsigned row = __builtin_clzll(bad); // row i sits at bit 63 - i
+                    size_t s = 0;
+                    for (size_t i = 0; i < m_checkBits; i++)
+                    {
+                        s |= ((syndrome[i * W + w] >> (63 - row)) & 1) << i;
+                    }
+                    if (s <= n)
+                    {
+                        code.Bits().Flip((g + 64 * w + row) * n + s - 1);
+                    }
+                    fixed++;
+                    bad &= ~(1ULL << (63 - row));
+                }
+            }
+        }
+        return fixed;
+    }
+
+    /// Drop the check bits of every row.
+    BitBlock Strip(const BitBlock& code) const
+    {
+        BitBlock data(code.Rows(), m_dataBits);
+        for (size_t r = 0; r < code.Rows(); r++)
+        {
+            StripRow(code.Bits(), r * CodeBits(), data.Bits(), r * m_dataBits);
+        }
+        return data;
+    }
+
+    /// Encode the row at bit \p in of \p data into the codeword at bit \p out of \p code.
+    void EncodeRow(const BitVec& data, size_t in, BitVec& code, size_t out) const
+    {
+        for (size_t i = 0; i < m_checkBits; i++)
+        {
+            code.Set(out + (size_t(1) << i) - 1, false);
+        }
+        for (const auto& run : m_runs)
+        {
+            Copy(data, in, code, out + run.first, run.second);
+            in += run.second;
+        }
+        uint64_t syndrome = Syndrome(code, out);
+        for (size_t i = 0; i < m_checkBits; i++)
+        {
+            code.Set(out + (size_t(1) << i) - 1, (syndrome >> i) & 1);
+        }
+    }
+
+    /**
+     * \brief Flip the bit named by the syndrome of the codeword at bit \p pos.
+     * \return true if the syndrome was non-zero.
+     */
+    bool CorrectRow(BitVec& code, size_t pos) const
+    {
+        uint64_t syndrome = Syndrome(code, pos);
+        if (syndrome == 0)
+        {
+            return false;
+        }
+        if (syndrome <= CodeBits())
+        {
+            code.Flip(pos + syndrome - 1);
+        }
+        return true;
+    }
+
+    /// Copy the data bits of the codeword at bit \p in of \p code to bit \p out of \p data.
+    void StripRow(const BitVec& code, size_t in, BitVec& data, size_t out) const
+    {
+        for (const auto& run : m_runs)
+        {
+            Copy(code, in + run.first, data, out, run.second);
+            out += run.second;
+        }
+    }
+
+    /// XOR of the 1-indexed positions of the set bits of the codeword at bit \p pos.
+    uint64_t Syndrome(const BitVec& code, size_t pos) const
+    {
+        uint64_t s = 0;
+        size_t n = CodeBits();
+        for (size_t i = 0; i < n; i += 64)
+        {
+            unsigned k = n - i < 64 ? n - i : 64;
+            uint64_t w = code.GetBits(pos + i, k);
+            while (w)
+            {
+                unsigned t = __builtin_ctzll(w);
+                s ^= i + k - t; // bit t from the right is position i + (k - 1 - t) + 1
+                w &= w - 1;
+            }
+        }
+        return s;
+    }
+
+  private:
+#ifdef TRANSPOSE_X86
+    __attribute__((target("avx2"))) void EncodeSliced256(const BitBlock& data, BitBlock& code) const
+    {
+        EncodeSliced<4>(data, code);
+    }
+
+    __attribute__((target("avx2"))) size_t CorrectSliced256(BitBlock& code) const
+    {
+        return CorrectSliced<4>(code);
+    }
+#else
+    void EncodeSliced256(const BitBlock& data, BitBlock& code) const
+    {
+        EncodeSliced<1>(data, code);
+    }
+
+    size_t CorrectSliced256(BitBlock& code) const
+    {
+        return CorrectSliced<1>(code);
+    }
+#endif
+
+    static void Copy(const BitVec& from, size_t in, BitVec& to, size_t out, size_t len)
+    {
+        for (size_t i = 0; i < len; i += 64)
+        {
+            unsigned k = len - i < 64 ? len - i : 64;
+            to.SetBits(out + i, k, from.GetBits(in + i, k));
+        }
+    }
+
+    size_t m_dataBits;                              //!< n, data bits per row.
+    size_t m_checkBits;                             //!< r, check bits per row.
+    std::vector<std::pair<size_t, size_t>> m_runs; //!< (0-indexed column, length) of each data run.
+    std::vector<size_t> m_dataPos;                 //!< 1-indexed codeword position of each data bit.
+};
+
+#endif /* HAMMING_H */
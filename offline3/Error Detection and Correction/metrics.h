@@ -0,0 +1,202 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+/// Codec stages timed by StageTimer, in pipeline order.
+enum Stage
+{
+    STAGE_PAD,
+    STAGE_BLOCK,
+    STAGE_ENCODE,
+    STAGE_SERIALIZE,
+    STAGE_CRC,
+    STAGE_CHANNEL,
+    STAGE_VERIFY,
+    STAGE_DESERIALIZE,
+    STAGE_CORRECT,
+    STAGE_DECODE,
+    STAGE_RECEIVE, //!< Codec::Receive, which fuses verify to decode.
+    STAGE_COUNT
+};
+
+inline const char*
+StageName(size_t s)
+{
+    static const char* const kNames[STAGE_COUNT] = {
+        "pad", "block", "encode", "serialize", "crc", "channel", "verify", "deserialize", "correct", "decode", "receive"};
+    return kNames[s];
+}
+
+/// Time and volume of one stage, summed over calls.
+struct StageMetric
+{
+    uint64_t calls = 0;
+    uint64_t nanos = 0; //!< Wall time inside the stage; on several threads, the sum over threads.
+    uint64_t bits = 0;  //!< Bits the stage consumed.
+};
+
+/**
+ * \brief Stage times and event counts of one run or one sweep point.
+ *
+ * Like SweepCounts, only integers are accumulated, so per-thread records
+ * can be added up in any order.
+ */
+struct CodecMetrics
+{
+    StageMetric stages[STAGE_COUNT];
+    uint64_t frames = 0;
+    uint64_t bitsFlipped = 0;       //!< Bits toggled by the channel.
+    uint64_t crcRejects = 0;        //!< Frames the CRC check failed.
+    uint64_t rowsCorrected = 0;     //!< Rows with a non-zero syndrome.
+    uint64_t rowsUncorrectable = 0; //!< Rows whose data was still wrong after correction.
+    uint64_t undetected = 0;        //!< Frames the CRC accepted with wrong data.
+
+    void Add(const CodecMetrics& o)
+    {
+        for (size_t s = 0; s < STAGE_COUNT; s++)
+        {
+            stages[s].calls += o.stages[s].calls;
+            stages[s].nanos += o.stages[s].nanos;
+            stages[s].bits += o.stages[s].bits;
+        }
+        frames += o.frames;
+        bitsFlipped += o.bitsFlipped;
+        crcRejects += o.crcRejects;
+        rowsCorrected += o.rowsCorrected;
+        rowsUncorrectable += o.rowsUncorrectable;
+        undetected += o.undetected;
+    }
+};
+
+/**
+ * \brief Adds the lifetime of the timer to one stage of a CodecMetrics.
+ *
+ * With a null record it does nothing, not even read the clock, so
+ * instrumented code paths cost one branch per stage when nobody asked for
+ * metrics.
+ */
+class StageTimer
+{
+  public:
+    StageTimer(CodecMetrics* metrics, Stage stage, uint64_t bits)
+        : m_metric(metrics ? &metrics->stages[stage] : nullptr)
+    {
+        if (m_metric)
+        {
+            m_metric->calls++;
+            m_metric->bits += bits;
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer()
+    {
+        if (m_metric)
+        {
+            m_metric->nanos +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start)
+                    .count();
+        }
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+  private:
+    StageMetric* m_metric;                         //!< Stage to charge, or nullptr.
+    std::chrono::steady_clock::time_point m_start; //!< When the stage started.
+};
+
+/// fn() timed as \p stage over \p bits; returns what fn returns.
+template <typename Fn>
+auto
+Timed(CodecMetrics* metrics, Stage stage, uint64_t bits, Fn fn) -> decltype(fn())
+{
+    StageTimer t(metrics, stage, bits);
+    return fn();
+}
+
+enum MetricsFormat
+{
+    METRICS_NONE,
+    METRICS_JSON,
+    METRICS_CSV
+};
+
+/// Parse "json" or "csv".
+inline MetricsFormat
+ParseMetricsFormat(const std::string& s)
+{
+    if (s == "json")
+    {
+        return METRICS_JSON;
+    }
+    if (s == "csv")
+    {
+        return METRICS_CSV;
+    }
+    throw std::invalid_argument("metrics format must be json or csv");
+}
+
+/// Column names of WriteMetrics in CSV form.
+inline void
+WriteMetricsHeader(FILE* out)
+{
+    std::fprintf(out, "p,m,generator,frames,bits_flipped,crc_rejects,rows_corrected,rows_uncorrectable,undetected");
+    for (size_t s = 0; s < STAGE_COUNT; s++)
+    {
+        const char* n = StageName(s);
+        std::fprintf(out, ",%s_calls,%s_ns,%s_bits,%s_bits_per_s", n, n, n, n);
+    }
+    std::fprintf(out, "\n");
+}
+
+/**
+ * \brief One record for the run or sweep point (p, m, generator).
+ *
+ * JSON records are single lines (JSON Lines); CSV records follow the
+ * columns of WriteMetricsHeader. Stages that never ran report zero calls
+ * and a throughput of 0.
+ */
+inline void
+WriteMetrics(FILE* out, MetricsFormat format, double p, size_t m, const std::string& generator,
+             const CodecMetrics& c)
+{
+    if (format == METRICS_NONE)
+    {
+        return;
+    }
+    bool json = format == METRICS_JSON;
+    std::fprintf(out,
+                 json ? "{\"p\":%g,\"m\":%zu,\"generator\":\"%s\",\"frames\":%llu,\"bits_flipped\":%llu,"
+                        "\"crc_rejects\":%llu,\"rows_corrected\":%llu,\"rows_uncorrectable\":%llu,"
+                        "\"undetected\":%llu,\"stages\":{"
+                      : "%g,%zu,%s,%llu,%llu,%llu,%llu,%llu,%llu",
+                 p, m, generator.c_str(), (unsigned long long)c.frames, (unsigned long long)c.bitsFlipped,
+                 (unsigned long long)c.crcRejects, (unsigned long long)c.rowsCorrected,
+                 (unsigned long long)c.rowsUncorrectable, (unsigned long long)c.undetected);
+    for (size_t s = 0; s < STAGE_COUNT; s++)
+    {
+        const StageMetric& st = c.stages[s];
+        double rate = st.nanos ? st.bits * 1e9 / st.nanos : 0;
+        if (json)
+        {
+            std::fprintf(out, "%s\"%s\":{\"calls\":%llu,\"ns\":%llu,\"bits\":%llu,\"bits_per_s\":%.6g}",
+                         s ? "," : "", StageName(s), (unsigned long long)st.calls, (unsigned long long)st.nanos,
+                         (unsigned long long)st.bits, rate);
+        }
+        else
+        {
+            std::fprintf(out, ",%llu,%llu,%llu,%.6g", (unsigned long long)st.calls, (unsigned long long)st.nanos,
+                         (unsigned long long)st.bits, rate);
+        }
+    }
+    std::fprintf(out, json ? "}}\n" : "\n");
+}
+
+#endif /* METRICS_H */
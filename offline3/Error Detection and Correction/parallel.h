@@ -0,0 +1,86 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief True on a thread that must not start more threads.
+ *
+ * Set while the thread runs ParallelFor tasks, or inside a SerialScope.
+ * Code that would fan out on its own, like ComputeWordsParallel, checks
+ * it and takes its serial path instead.
+ */
+inline bool&
+InParallelFor()
+{
+    thread_local bool inside = false;
+    return inside;
+}
+
+/// Marks the current thread as InParallelFor until the end of the scope.
+class SerialScope
+{
+  public:
+    SerialScope()
+        : m_outer(InParallelFor())
+    {
+        InParallelFor() = true;
+    }
+
+    ~SerialScope()
+    {
+        InParallelFor() = m_outer;
+    }
+
+    SerialScope(const SerialScope&) = delete;
+    SerialScope& operator=(const SerialScope&) = delete;
+
+  private:
+    bool m_outer;
+};
+
+/**
+ * \brief Call fn(t) for t in [0, tasks) on \p threads threads (0 for all cores).
+ *
+ * Tasks are handed out from a shared counter, so a slow task does not
+ * hold up the others. Called from within a task, it runs every task on
+ * the calling thread, so nesting does not multiply the threads.
+ */
+template <typename Fn>
+void
+ParallelFor(size_t tasks, size_t threads, Fn fn)
+{
+    if (InParallelFor())
+    {
+        for (size_t t = 0; t < tasks; t++)
+        {
+            fn(t);
+        }
+        return;
+    }
+    std::atomic<size_t> next(0);
+    auto worker = [&] {
+        SerialScope serial;
+        for (size_t t = next++; t < tasks; t = next++)
+        {
+            fn(t);
+        }
+    };
+    size_t n = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for (size_t k = 1; k < n && k < tasks; k++)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& th : pool)
+    {
+        th.join();
+    }
+}
+
+#endif /* PARALLEL_H */
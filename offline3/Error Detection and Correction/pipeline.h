@@ -0,0 +1,372 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "channel.h"
+#include "codec.h"
+#include "parallel.h"
+#include "rng.h"
+#include "stream.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * \brief Bounded lock-free ring between one producer and one consumer thread.
+ *
+ * Each side owns one index and caches the other's, so in the common case
+ * a push or pop touches no shared cache line besides the slot itself.
+ * The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscRing
+{
+  public:
+    explicit SpscRing(size_t capacity)
+        : m_head(0),
+          m_tailCache(0),
+          m_tail(0),
+          m_headCache(0)
+    {
+        size_t n = 1;
+        while (n < capacity)
+        {
+            n <<= 1;
+        }
+        m_slots.resize(n);
+        m_mask = n - 1;
+    }
+
+    /// Move \p item in unless the ring is full. Producer only.
+    bool TryPush(T& item)
+    {
+        size_t t = m_tail.load(std::memory_order_relaxed);
+        if (t - m_headCache == m_slots.size())
+        {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (t - m_headCache == m_slots.size())
+            {
+                return false;
+            }
+        }
+        m_slots[t & m_mask] = std::move(item);
+        m_tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Move the oldest item out unless the ring is empty. Consumer only.
+    bool TryPop(T& item)
+    {
+        size_t h = m_head.load(std::memory_order_relaxed);
+        if (h == m_tailCache)
+        {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (h == m_tailCache)
+            {
+                return false;
+            }
+        }
+        item = std::move(m_slots[h & m_mask]);
+        m_head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Items in the ring; exact only when read by one of the two sides.
+    size_t Size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    size_t Capacity() const
+    {
+        return m_slots.size();
+    }
+
+  private:
+    std::vector<T> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head; //!< Next slot to pop, written by the consumer.
+    size_t m_tailCache;                     //!< Consumer's last view of m_tail.
+    alignas(64) std::atomic<size_t> m_tail; //!< Next slot to fill, written by the producer.
+    size_t m_headCache;                     //!< Producer's last view of m_head.
+};
+
+/// Where the time of one pipeline stage went.
+struct StageStats
+{
+    const char* name = "";
+    uint64_t items = 0;
+    double busy = 0;         //!< Seconds spent working on items.
+    double starved = 0;      //!< Seconds waiting for the previous stage.
+    double blocked = 0;      //!< Seconds waiting for room in the next ring (backpressure).
+    uint64_t queued = 0;     //!< Sum of the output ring size seen at every push.
+    size_t capacity = 0;     //!< Size of the output ring, 0 for the last stage.
+};
+
+/// One chunk on its way through the pipeline.
+struct PipelineItem
+{
+    uint64_t index = 0;
+    bool last = false;    //!< End-of-input marker, carries no chunk.
+    std::string chunk;    //!< Input bytes.
+    BitBlock encoded;     //!< Rows with check bits.
+    BitVec frame;         //!< Sent, then received frame.
+    size_t flips = 0;
+    ReceiveResult rx{true, 0};
+    std::string decoded;  //!< Output bytes.
+};
+
+/**
+ * \brief RunStream with every stage on its own thread.
+ *
+ * Stages: read + pad/encode, serialize + CRC, channel, verify + decode,
+ * output. They are chained by SpscRings of \p depth chunks, rounded up
+ * to a power of two. A stage that finds its output ring full waits,
+ * which holds the whole pipeline to the pace of the slowest stage with a
+ * bounded number of chunks in flight.
+ * Every ring is FIFO and every stage a single thread, so chunks leave in
+ * input order and the output and statistics are those of RunStream.
+ * \p stages receives the time split of every stage.
+ *
+ * A stage that throws passes the end marker on in place of the chunk and
+ * then drains its input, so every thread finishes; the reader stops at
+ * the next chunk. The first exception is rethrown once all threads have
+ * joined, and the output holds the chunks before the failing one.
+ */
+inline StreamStats
+RunStreamPipelined(ChunkReader& in, const Codec& codec, const Channel& channel, uint64_t seed, FILE* out,
+                   size_t depth, std::vector<StageStats>& stages)
+{
+    typedef std::chrono::steady_clock Clock;
+    const size_t kStages = 5;
+    std::vector<std::unique_ptr<SpscRing<PipelineItem>>> rings;
+    for (size_t i = 0; i + 1 < kStages; i++)
+    {
+        rings.emplace_back(new SpscRing<PipelineItem>(depth));
+    }
+    stages.assign(kStages, StageStats());
+    const char* names[kStages] = {"encode", "serialize", "channel", "decode", "output"};
+    for (size_t i = 0; i < kStages; i++)
+    {
+        stages[i].name = names[i];
+        stages[i].capacity = i < rings.size() ? rings[i]->Capacity() : 0;
+    }
+
+    auto seconds = [](Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<double>(b - a).count();
+    };
+    auto pop = [&](size_t stage, PipelineItem& item) {
+        Clock::time_point t0 = Clock::now();
+        while (!rings[stage - 1]->TryPop(item))
+        {
+            std::this_thread::yield();
+        }
+        stages[stage].starved += seconds(t0, Clock::now());
+    };
+    std::mutex errorLock;
+    std::exception_ptr error;
+    std::atomic<bool> failed(false);
+    // keeps the first exception of any stage
+    auto fail = [&] {
+        std::lock_guard<std::mutex> lock(errorLock);
+        if (!error)
+        {
+            error = std::current_exception();
+        }
+        failed = true;
+    };
+    auto push = [&](size_t stage, PipelineItem& item) {
+        stages[stage].queued += rings[stage]->Size();
+        Clock::time_point t0 = Clock::now();
+        while (!rings[stage]->TryPush(item))
+        {
+            std::this_thread::yield();
+        }
+        stages[stage].blocked += seconds(t0, Clock::now());
+    };
+    // runs fn on every item between two rings, passing the end marker on; every stage
+    // has its own thread already, so a large chunk is not checksummed on more
+    auto middle = [&](size_t stage, auto fn) {
+        return std::thread([&, stage, fn] {
+            SerialScope serial;
+            PipelineItem item;
+            bool ended = false; // the end marker went on early, after a failure
+            for (;;)
+            {
+                pop(stage, item);
+                if (item.last)
+                {
+                    if (!ended)
+                    {
+                        push(stage, item);
+                    }
+                    return;
+                }
+                if (ended)
+                {
+                    continue; // drain what the stages in front still send
+                }
+                Clock::time_point t0 = Clock::now();
+                try
+                {
+                    fn(item);
+                }
+                catch (...)
+                {
+                    fail();
+                    ended = true;
+                    item = PipelineItem();
+                    item.last = true;
+                    push(stage, item);
+                    continue;
+                }
+                stages[stage].busy += seconds(t0, Clock::now());
+                stages[stage].items++;
+                push(stage, item);
+            }
+        });
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] {
+        PipelineItem item;
+        const char* data;
+        size_t len;
+        for (uint64_t index = 0;; index++)
+        {
+            Clock::time_point t0 = Clock::now();
+            bool more = false;
+            item = PipelineItem();
+            try
+            {
+                more = !failed && in.Next(data, len);
+                if (more)
+                {
+                    item.chunk.assign(data, len);
+                    item.encoded = codec.AddCheckBits(codec.DataBlock(codec.Pad(item.chunk)));
+                    stages[0].items++;
+                }
+            }
+            catch (...)
+            {
+                fail();
+                more = false;
+                item = PipelineItem();
+            }
+            item.index = index;
+            item.last = !more;
+            stages[0].busy += seconds(t0, Clock::now());
+            push(0, item);
+            if (!more)
+            {
+                return;
+            }
+        }
+    });
+    threads.push_back(middle(1, [&](PipelineItem& item) {
+        item.frame = codec.AppendCrc(codec.Serialize(item.encoded));
+        item.encoded = BitBlock();
+    }));
+    threads.push_back(middle(2, [&](PipelineItem& item) {
+        Philox4x32 rng(seed, item.index);
+        item.flips = channel.Apply(item.frame, rng);
+    }));
+    threads.push_back(middle(3, [&](PipelineItem& item) {
+        item.decoded.resize(codec.FrameRows(item.frame) * codec.M());
+        item.rx = codec.Receive(item.frame, &item.decoded[0]);
+        item.decoded.resize(item.chunk.size());
+    }));
+
+    StreamStats s;
+    const CrcEngine& crc = codec.Crc();
+    bool writeFailed = false;
+    bool outputFailed = false;
+    PipelineItem item;
+    for (;;)
+    {
+        pop(4, item);
+        if (item.last)
+        {
+            break;
+        }
+        if (outputFailed)
+        {
+            continue; // keep draining so the other stages can finish
+        }
+        Clock::time_point t0 = Clock::now();
+        try
+        {
+            size_t len = item.chunk.size();
+            s.bitsFlipped += item.flips;
+            s.crcRejected += !item.rx.crcOk;
+            s.rowsCorrected += item.rx.rowsCorrected;
+            s.badChunks += item.decoded != item.chunk;
+            s.sentCrc = crc.Combine(s.sentCrc, crc.Compute((const uint8_t*)item.chunk.data(), 8 * len), 8 * len);
+            s.receivedCrc = crc.Combine(s.receivedCrc, crc.Compute((const uint8_t*)item.decoded.data(), 8 * len), 8 * len);
+            s.chunks++;
+            s.bytes += len;
+            if (out && !writeFailed && std::fwrite(item.decoded.data(), 1, len, out) != len)
+            {
+                writeFailed = true; // keep draining so the other stages can finish
+            }
+        }
+        catch (...)
+        {
+            fail();
+            outputFailed = true;
+            continue;
+        }
+        stages[4].busy += seconds(t0, Clock::now());
+        stages[4].items++;
+    }
+    for (std::thread& th : threads)
+    {
+        th.join();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    if (writeFailed)
+    {
+        throw std::runtime_error("write failed");
+    }
+    return s;
+}
+
+/**
+ * \brief One line per stage: items, busy / starved / blocked share of the wall time, mean output ring fill.
+ *
+ * The stage with the highest busy share is the bottleneck; the stages in
+ * front of it show up as blocked, the ones behind it as starved.
+ */
+inline void
+PrintStages(const std::vector<StageStats>& stages, double wall, FILE* out = stderr)
+{
+    std::fprintf(out, "%-10s %10s %8s %8s %8s %10s\n", "stage", "items", "busy", "starved", "blocked", "queue");
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        const StageStats& st = stages[i];
+        std::fprintf(out, "%-10s %10llu %7.1f%% %7.1f%% %7.1f%%", st.name, (unsigned long long)st.items,
+                     100 * st.busy / wall, 100 * st.starved / wall, 100 * st.blocked / wall);
+        if (st.capacity)
+        {
+            std::fprintf(out, " %6.2f/%zu\n", (double)st.queued / (st.items + 1), st.capacity);
+        }
+        else
+        {
+            std::fprintf(out, " %10s\n", "-");
+        }
+    }
+}
+
+#endif /* PIPELINE_H */
@@ -0,0 +1,366 @@
+#ifndef RARE_H
+#define RARE_H
+
+#include "codec.h"
+#include "rng.h"
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * \file
+ * \brief Rare-event estimates for the Hamming + CRC codec at very small p.
+ *
+ * At p = 1e-9 a frame of a few thousand bits almost never sees even two
+ * errors, so plain Monte-Carlo needs billions of frames to observe an
+ * undetected CRC error or a Hamming miscorrection. Here the channel is
+ * split by error weight instead:
+ *
+ *   P(event) = sum_w P(W = w) * P(event | w errors)
+ *
+ * P(W = w) is the binomial weight distribution of the frame and is known
+ * exactly. The conditional probabilities do not depend on p at all, so
+ * they are estimated once per (m, generator) with error patterns of
+ * exactly w bits: this is importance sampling with the channel biased to
+ * weight w and every pattern reweighted by the likelihood ratio
+ * P(W = w) / Q(W = w). Weights with few enough patterns are enumerated
+ * outright, which makes their term exact.
+ *
+ * Every code in the pipeline is linear and the decoder acts on the
+ * syndrome only, so what happens to a frame depends on the error pattern
+ * and not on the message. One random message per configuration is sent
+ * through the ordinary Codec stages for every pattern.
+ */
+
+/// Outcomes of a batch of error patterns of one weight.
+struct RareCounts
+{
+    uint64_t patterns = 0;
+    uint64_t crcMissed = 0;    //!< Frames the CRC accepted although bits were flipped.
+    uint64_t frameErrors = 0;  //!< Frames with a residual data error after correction.
+    uint64_t silent = 0;       //!< Residual data error and accepted by the CRC.
+    uint64_t miscorrected = 0; //!< Frames where Hamming flipped a bit that was right.
+
+    void Add(const RareCounts& o)
+    {
+        patterns += o.patterns;
+        crcMissed += o.crcMissed;
+        frameErrors += o.frameErrors;
+        silent += o.silent;
+        miscorrected += o.miscorrected;
+    }
+};
+
+struct RareOptions
+{
+    size_t maxWeight = 6;          //!< Highest error weight simulated; heavier patterns go to the tail bound.
+    size_t trials = 10000;         //!< Sampled patterns per weight.
+    uint64_t exactLimit = 1000000; //!< Enumerate a weight outright if it has at most this many patterns.
+    size_t length = 64;            //!< Characters per message, before padding.
+    size_t threads = 0;            //!< Worker threads, 0 for all cores.
+    uint64_t seed = 1;             //!< Run seed, the Philox key.
+    size_t chunk = 256;            //!< Sampled patterns per work item.
+};
+
+/// Conditional outcome counts of one (m, generator) configuration, index w - 1 for weight w.
+struct RareProfile
+{
+    size_t m;
+    std::string generator;
+    size_t frameBits;              //!< Bits on the wire, checksum included.
+    std::vector<RareCounts> counts;
+    std::vector<bool> exact;       //!< True if weight w was enumerated rather than sampled.
+};
+
+/// log of the binomial coefficient C(n, k).
+inline double
+LogChoose(size_t n, size_t k)
+{
+    return std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0);
+}
+
+/// P(W = w) for W ~ Binomial(n, p), in log space so p = 1e-10 does not underflow.
+inline double
+BinomialPmf(size_t n, size_t w, double p)
+{
+    if (p <= 0)
+    {
+        return w == 0;
+    }
+    if (p >= 1)
+    {
+        return w == n;
+    }
+    return std::exp(LogChoose(n, w) + w * std::log(p) + (n - w) * std::log1p(-p));
+}
+
+/// P(W > w) for W ~ Binomial(n, p), summed term by term to avoid 1 - (1 - x) cancellation.
+inline double
+BinomialTail(size_t n, size_t w, double p)
+{
+    double tail = 0;
+    for (size_t k = w + 1; k <= n; k++)
+    {
+        double t = BinomialPmf(n, k, p);
+        tail += t;
+        if (k > n * p && t < tail * 1e-17)
+        {
+            break;
+        }
+    }
+    return tail;
+}
+
+/**
+ * \brief A message and its encoded forms, kept to judge error patterns against.
+ */
+class RareFrame
+{
+  public:
+    template <typename Rng>
+    RareFrame(const Codec& codec, size_t length, Rng& rng)
+        : m_codec(codec)
+    {
+        std::string data(length, '\0');
+        for (size_t i = 0; i < length; i++)
+        {
+            data[i] = (char)rng();
+        }
+        m_block = codec.DataBlock(codec.Pad(data));
+        m_encoded = codec.AddCheckBits(m_block);
+        m_frame = codec.AppendCrc(codec.Serialize(m_encoded));
+    }
+
+    size_t Size() const
+    {
+        return m_frame.Size();
+    }
+
+    /// Flip \p w positions of the sent frame, run the receiver and count the outcome.
+    void Evaluate(const size_t* pos, size_t w, RareCounts& c) const
+    {
+        BitVec received = m_frame;
+        for (size_t i = 0; i < w; i++)
+        {
+            received.Flip(pos[i]);
+        }
+        bool crcOk = m_codec.CheckCrc(received);
+        BitBlock rxBlock = m_codec.Deserialize(received);
+        std::vector<std::pair<size_t, size_t>> hit; // (row, bit errors before correction)
+        for (size_t r = 0; r < rxBlock.Rows(); r++)
+        {
+            size_t d = rxBlock.RowDistance(m_encoded, r);
+            if (d)
+            {
+                hit.emplace_back(r, d);
+            }
+        }
+        m_codec.CorrectRows(rxBlock);
+        bool miscorrected = false;
+        for (const auto& h : hit)
+        {
+            miscorrected |= rxBlock.RowDistance(m_encoded, h.first) > h.second;
+        }
+        bool residual = false;
+        BitBlock out = m_codec.RemoveCheckBits(rxBlock);
+        for (size_t i = 0; i < hit.size() && !residual; i++)
+        {
+            residual = !out.RowEquals(m_block, hit[i].first);
+        }
+
+        c.patterns++;
+        c.crcMissed += w > 0 && crcOk;
+        c.frameErrors += residual;
+        c.silent += residual && crcOk;
+        c.miscorrected += miscorrected;
+    }
+
+  private:
+    const Codec& m_codec;
+    BitBlock m_block;   //!< Data block of the message.
+    BitBlock m_encoded; //!< Rows with check bits.
+    BitVec m_frame;     //!< Sent frame.
+};
+
+/// \p w distinct positions below \p n, uniformly (Floyd's sampling).
+template <typename Rng>
+void
+RandomPattern(size_t n, size_t w, Rng& rng, size_t* pos)
+{
+    for (size_t j = n - w, k = 0; j < n; j++, k++)
+    {
+        size_t t = rng() % (j + 1);
+        pos[k] = std::find(pos, pos + k, t) == pos + k ? t : j;
+    }
+}
+
+/**
+ * \brief Every pattern of weight \p w whose lowest flipped bit is \p first.
+ */
+inline void
+EnumeratePatterns(const RareFrame& frame, size_t w, size_t first, RareCounts& c)
+{
+    size_t n = frame.Size();
+    if (first + w > n)
+    {
+        return;
+    }
+    std::vector<size_t> pos(w);
+    for (size_t k = 0; k < w; k++)
+    {
+        pos[k] = first + k;
+    }
+    for (;;)
+    {
+        frame.Evaluate(pos.data(), w, c);
+        size_t j = w - 1;
+        while (j > 0 && pos[j] == n - w + j)
+        {
+            j--;
+        }
+        if (j == 0)
+        {
+            return;
+        }
+        pos[j]++;
+        for (size_t k = j + 1; k < w; k++)
+        {
+            pos[k] = pos[k - 1] + 1;
+        }
+    }
+}
+
+/**
+ * \brief Conditional outcome counts for weights 1..maxWeight of every configuration.
+ *
+ * Enumerated weights are split into one work item per lowest flipped bit,
+ * sampled weights into chunks of patterns; pattern t of weight w of
+ * configuration i draws from Philox stream TrialStream(64 i + w, t), so
+ * the result does not depend on the thread count.
+ */
+inline std::vector<RareProfile>
+RunRare(const std::vector<std::pair<size_t, std::string>>& configs, const RareOptions& opt)
+{
+    struct Task
+    {
+        size_t config;
+        size_t w;
+        size_t first; //!< Lowest flipped bit, or first sampled pattern.
+        bool exact;
+    };
+
+    std::vector<Codec> codecs;
+    std::vector<RareFrame> frames;
+    std::vector<RareProfile> profiles;
+    codecs.reserve(configs.size()); // frames keep references into codecs
+    for (size_t i = 0; i < configs.size(); i++)
+    {
+        codecs.emplace_back(configs[i].first, configs[i].second);
+        Philox4x32 rng(opt.seed, TrialStream(64 * i, 0));
+        frames.emplace_back(codecs[i], opt.length, rng);
+        size_t n = frames[i].Size();
+        RareProfile prof{configs[i].first, configs[i].second, n, {}, {}};
+        for (size_t w = 1; w <= opt.maxWeight && w <= n; w++)
+        {
+            prof.exact.push_back(LogChoose(n, w) <= std::log((double)opt.exactLimit) + 1e-9);
+        }
+        prof.counts.resize(prof.exact.size());
+        profiles.push_back(prof);
+    }
+
+    std::vector<Task> tasks;
+    for (size_t i = 0; i < profiles.size(); i++)
+    {
+        for (size_t w = 1; w <= profiles[i].exact.size(); w++)
+        {
+            size_t items = profiles[i].exact[w - 1] ? profiles[i].frameBits : opt.trials;
+            size_t step = profiles[i].exact[w - 1] ? 1 : opt.chunk;
+            for (size_t first = 0; first < items; first += step)
+            {
+                tasks.push_back({i, w, first, profiles[i].exact[w - 1]});
+            }
+        }
+    }
+
+    std::vector<RareCounts> partial(tasks.size());
+    ParallelFor(tasks.size(), opt.threads, [&](size_t t) {
+        const Task& task = tasks[t];
+        const RareFrame& frame = frames[task.config];
+        if (task.exact)
+        {
+            EnumeratePatterns(frame, task.w, task.first, partial[t]);
+            return;
+        }
+        std::vector<size_t> pos(task.w);
+        size_t last = std::min(opt.trials, task.first + opt.chunk);
+        for (size_t trial = task.first; trial < last; trial++)
+        {
+            Philox4x32 rng(opt.seed, TrialStream(64 * task.config + task.w, trial));
+            RandomPattern(frame.Size(), task.w, rng, pos.data());
+            frame.Evaluate(pos.data(), task.w, partial[t]);
+        }
+    });
+
+    for (size_t t = 0; t < tasks.size(); t++)
+    {
+        profiles[tasks[t].config].counts[tasks[t].w - 1].Add(partial[t]);
+    }
+    return profiles;
+}
+
+/**
+ * \brief Print one tab-separated line per (profile, p) with the reweighted probabilities.
+ *
+ * Columns: p m generator frame_bits, then estimate/low/high for an
+ * undetected error (the CRC accepts a corrupted frame), a frame error
+ * (wrong data after correction), a silent frame error (both) and a
+ * Hamming miscorrection, and finally the tail mass P(W > maxWeight).
+ * The bounds add up the 95% Wilson bounds of the sampled weights, exact
+ * weights contribute their value to both, and the high bound also takes
+ * the whole tail, so it stays an upper bound whatever happens there.
+ */
+inline void
+PrintRare(const std::vector<RareProfile>& profiles, const std::vector<double>& ps, FILE* out = stdout)
+{
+    std::fprintf(out, "#p\tm\tgenerator\tframe_bits\tundetected\tund_lo\tund_hi\tfer\tfer_lo\tfer_hi"
+                      "\tsilent\tsil_lo\tsil_hi\tmiscorrect\tmis_lo\tmis_hi\ttail\n");
+    for (const RareProfile& prof : profiles)
+    {
+        for (double p : ps)
+        {
+            double est[4] = {0, 0, 0, 0};
+            double lo[4] = {0, 0, 0, 0};
+            double hi[4] = {0, 0, 0, 0};
+            for (size_t w = 1; w <= prof.counts.size(); w++)
+            {
+                const RareCounts& c = prof.counts[w - 1];
+                double pw = BinomialPmf(prof.frameBits, w, p);
+                uint64_t k[4] = {c.crcMissed, c.frameErrors, c.silent, c.miscorrected};
+                for (int e = 0; e < 4; e++)
+                {
+                    double f = c.patterns ? (double)k[e] / c.patterns : 0;
+                    std::pair<double, double> ci = prof.exact[w - 1] ? std::make_pair(f, f)
+                                                                     : WilsonInterval(k[e], c.patterns);
+                    est[e] += pw * f;
+                    lo[e] += pw * ci.first;
+                    hi[e] += pw * ci.second;
+                }
+            }
+            double tail = BinomialTail(prof.frameBits, prof.counts.size(), p);
+            std::fprintf(out, "%g\t%zu\t%s\t%zu", p, prof.m, prof.generator.c_str(), prof.frameBits);
+            for (int e = 0; e < 4; e++)
+            {
+                std::fprintf(out, "\t%.6g\t%.6g\t%.6g", est[e], lo[e], std::min(1.0, hi[e] + tail));
+            }
+            std::fprintf(out, "\t%.6g\n", tail);
+        }
+    }
+}
+
+#endif /* RARE_H */
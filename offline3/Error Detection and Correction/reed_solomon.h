@@ -0,0 +1,438 @@
+#ifndef REED_SOLOMON_H
+#define REED_SOLOMON_H
+
+#include "arena.h"
+#include "bitblock.h"
+#include "gf256.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Systematic Reed-Solomon row code over GF(2^8), the alternative to Hamming.
+ *
+ * A row of k data bytes gets 2t parity bytes appended, the remainder of
+ * data * x^2t divided by g(x) = (x - 1)(x - alpha)...(x - alpha^(2t-1)),
+ * and any t wrong bytes of the k + 2t can be put right; k + 2t is at
+ * most 255 (a shortened code). Byte j of a row is the coefficient of
+ * x^(n-1-j), so the data comes first and the row is the data block row
+ * followed by the parity, as with the other stages of the pipeline.
+ *
+ * Rows are processed a group at a time in byte columns: column j of the
+ * group holds byte j of every row. Every row shares the generator and
+ * the evaluation points, so both the encoder's LFSR step and Horner's
+ * rule for the syndromes multiply a whole column by one constant, which
+ * is what the split-nibble region kernels of GfRegionBest do. Only rows
+ * with a non-zero syndrome go through Berlekamp-Massey, the Chien search
+ * and Forney's formula, one by one.
+ */
+class ReedSolomon
+{
+  public:
+    /// Rows per group of the byte-column kernels.
+    static constexpr size_t kGroupRows = 256;
+
+    /// \param dataBytes k bytes per row. \param parity 2t parity bytes per row.
+    ReedSolomon(size_t dataBytes, size_t parity)
+        : m_k(dataBytes),
+          m_parity(parity),
+          m_kernels(GfRegionBest())
+    {
+        if (dataBytes == 0 || parity == 0 || dataBytes + parity > 255)
+        {
+            throw std::invalid_argument("reed-solomon needs m >= 1, parity >= 1 and m + parity <= 255");
+        }
+        std::vector<uint8_t> gen(1, 1); // highest degree first
+        for (size_t i = 0; i < parity; i++)
+        {
+            uint8_t root = Gf256::Exp(i);
+            gen.push_back(0);
+            for (size_t j = gen.size() - 1; j > 0; j--)
+            {
+                gen[j] ^= Gf256::Mul(gen[j - 1], root);
+            }
+        }
+        for (size_t i = 0; i < parity; i++)
+        {
+            m_genTables.push_back(Gf256::Table(gen[i + 1]));
+            m_rootTables.push_back(Gf256::Table(Gf256::Exp(i)));
+        }
+    }
+
+    size_t DataBytes() const
+    {
+        return m_k;
+    }
+
+    size_t ParityBytes() const
+    {
+        return m_parity;
+    }
+
+    size_t CodeBytes() const
+    {
+        return m_k + m_parity;
+    }
+
+    size_t DataBits() const
+    {
+        return 8 * m_k;
+    }
+
+    size_t CheckBits() const
+    {
+        return 8 * m_parity;
+    }
+
+    size_t CodeBits() const
+    {
+        return 8 * CodeBytes();
+    }
+
+    /// Wrong bytes per row that are always corrected.
+    size_t Correctable() const
+    {
+        return m_parity / 2;
+    }
+
+    /// True if 0-indexed column \p col of a codeword holds a parity bit.
+    bool IsCheckColumn(size_t col) const
+    {
+        return col >= 8 * m_k;
+    }
+
+    /// Name of the region kernels in use, for benchmark output.
+    const char* KernelName() const
+    {
+        return m_kernels.name;
+    }
+
+    /// Append the parity bytes to every row of \p data.
+    BitBlock Encode(const BitBlock& data) const
+    {
+        BitBlock code;
+        Encode(data, code);
+        return code;
+    }
+
+    /// Encode into \p code, reusing its storage.
+    void Encode(const BitBlock& data, BitBlock& code) const
+    {
+        size_t n = CodeBytes();
+        code.Reset(data.Rows(), CodeBits());
+        ArenaScope scope;
+        uint8_t* cols = Bytes(scope, n * kGroupRows);
+        for (size_t g = 0; g < data.Rows(); g += kGroupRows)
+        {
+            size_t rows = std::min(kGroupRows, data.Rows() - g);
+            Gather(data.Bits(), g, rows, m_k, cols);
+            EncodeColumns(cols, kGroupRows, rows);
+            for (size_t r = 0; r < rows; r++)
+            {
+                Copy(data.Bits(), (g + r) * DataBits(), code.Bits(), (g + r) * CodeBits(), DataBits());
+                for (size_t j = m_k; j < n; j += 8)
+                {
+                    unsigned k = n - j < 8 ? n - j : 8;
+                    uint64_t v = 0;
+                    for (unsigned b = 0; b < k; b++)
+                    {
+                        v = (v << 8) | cols[(j + b) * kGroupRows + r];
+                    }
+                    code.Bits().XorBits((g + r) * CodeBits() + 8 * j, 8 * k, v);
+                }
+            }
+        }
+    }
+
+    /**
+     * \brief Correct up to t wrong bytes in every row of \p code, in place.
+     *
+     * Rows with more errors than the decoder can locate are left as they
+     * arrived.
+     * \return number of rows whose syndrome was non-zero.
+     */
+    size_t Correct(BitBlock& code) const
+    {
+        size_t n = CodeBytes();
+        ArenaScope scope;
+        uint8_t* cols = Bytes(scope, n * kGroupRows);
+        uint8_t* hit = Bytes(scope, kGroupRows);
+        size_t bad = 0;
+        for (size_t g = 0; g < code.Rows(); g += kGroupRows)
+        {
+            size_t rows = std::min(kGroupRows, code.Rows() - g);
+            Gather(code.Bits(), g, rows, n, cols);
+            bad += CorrectColumns(cols, kGroupRows, rows, hit);
+            for (size_t r = 0; r < rows; r++)
+            {
+                for (size_t j = 0; hit[r] && j < n; j++)
+                {
+                    code.Bits().SetBits((g + r) * CodeBits() + 8 * j, 8, cols[j * kGroupRows + r]);
+                }
+            }
+        }
+        return bad;
+    }
+
+    /// The data bytes of every row, parity dropped.
+    BitBlock Strip(const BitBlock& code) const
+    {
+        BitBlock data(code.Rows(), DataBits());
+        for (size_t r = 0; r < code.Rows(); r++)
+        {
+            Copy(code.Bits(), r * CodeBits(), data.Bits(), r * DataBits(), DataBits());
+        }
+        return data;
+    }
+
+    /**
+     * \brief Fill parity columns k..n-1 from data columns 0..k-1.
+     *
+     * Byte j of row r is at cols[j * stride + r]. The LFSR register keeps
+     * one column per parity byte; the register is rotated by index
+     * instead of moving columns, so every data column costs 2t region
+     * multiply-adds.
+     */
+    void EncodeColumns(uint8_t* cols, size_t stride, size_t rows) const
+    {
+        ArenaScope scope;
+        uint8_t* reg = Bytes(scope, m_parity * stride);
+        uint8_t* feedback = Bytes(scope, stride);
+        std::fill(reg, reg + m_parity * stride, 0);
+        size_t head = 0; // register byte i, highest degree first, is column (head + i) % 2t
+        for (size_t j = 0; j < m_k; j++)
+        {
+            uint8_t* top = reg + head * stride;
+            const uint8_t* data = cols + j * stride;
+            for (size_t r = 0; r < rows; r++)
+            {
+                feedback[r] = data[r] ^ top[r];
+                top[r] = 0;
+            }
+            head = head + 1 == m_parity ? 0 : head + 1;
+            for (size_t i = 0; i < m_parity; i++)
+            {
+                m_kernels.mulAdd(reg + (head + i) % m_parity * stride, feedback, rows, m_genTables[i]);
+            }
+        }
+        for (size_t i = 0; i < m_parity; i++)
+        {
+            std::copy(reg + (head + i) % m_parity * stride, reg + (head + i) % m_parity * stride + rows,
+                      cols + (m_k + i) * stride);
+        }
+    }
+
+    /**
+     * \brief Correct the rows held in byte columns, laid out as for EncodeColumns.
+     * \param hit if not null, hit[r] is set to whether row r had a non-zero syndrome.
+     * \return number of rows whose syndrome was non-zero.
+     */
+    size_t CorrectColumns(uint8_t* cols, size_t stride, size_t rows, uint8_t* hit = nullptr) const
+    {
+        size_t n = CodeBytes();
+        ArenaScope scope;
+        uint8_t* syn = Bytes(scope, m_parity * stride);
+        std::fill(syn, syn + m_parity * stride, 0);
+        for (size_t j = 0; j < n; j++)
+        {
+            for (size_t i = 0; i < m_parity; i++)
+            {
+                m_kernels.horner(syn + i * stride, cols + j * stride, rows, m_rootTables[i]);
+            }
+        }
+        size_t bad = 0;
+        uint8_t row[255];
+        for (size_t r = 0; r < rows; r++)
+        {
+            uint8_t any = 0;
+            for (size_t i = 0; i < m_parity; i++)
+            {
+                row[i] = syn[i * stride + r];
+                any |= row[i];
+            }
+            if (hit)
+            {
+                hit[r] = any != 0;
+            }
+            if (any)
+            {
+                bad++;
+                DecodeRow(row, cols + r, stride);
+            }
+        }
+        return bad;
+    }
+
+    /**
+     * \brief Locate and fix the errors of one row from its syndromes S_0..S_2t-1.
+     *
+     * Berlekamp-Massey finds the error locator Lambda, the Chien search
+     * its roots among the n positions of the shortened code, and Forney's
+     * formula the error values, with Omega = S * Lambda mod x^2t. Byte j of
+     * the row is at code[j * stride].
+     * \return false, leaving the row alone, if the errors could not be located.
+     */
+    bool DecodeRow(const uint8_t* syn, uint8_t* code, size_t stride) const
+    {
+        size_t n = CodeBytes();
+        size_t t2 = m_parity;
+        uint8_t lambda[256] = {1};
+        uint8_t prev[256] = {1};
+        uint8_t saved[256];
+        size_t degree = 0;
+        size_t shift = 1;
+        uint8_t lastD = 1;
+        for (size_t r = 0; r < t2; r++)
+        {
+            uint8_t d = syn[r];
+            for (size_t i = 1; i <= degree; i++)
+            {
+                d ^= Gf256::Mul(lambda[i], syn[r - i]);
+            }
+            if (d == 0)
+            {
+                shift++;
+                continue;
+            }
+            uint8_t coef = Gf256::Div(d, lastD);
+            bool grow = 2 * degree <= r;
+            if (grow)
+            {
+                std::copy(lambda, lambda + t2 + 1, saved);
+            }
+            for (size_t i = 0; i + shift <= t2; i++)
+            {
+                lambda[i + shift] ^= Gf256::Mul(coef, prev[i]);
+            }
+            if (grow)
+            {
+                degree = r + 1 - degree;
+                std::copy(saved, saved + t2 + 1, prev);
+                lastD = d;
+                shift = 1;
+            }
+            else
+            {
+                shift++;
+            }
+        }
+        if (2 * degree > t2)
+        {
+            return false;
+        }
+
+        size_t where[128];
+        size_t roots = 0;
+        for (size_t j = 0; j < n; j++)
+        {
+            size_t inv = (255 - (n - 1 - j)) % 255; // log of X^-1 for X = alpha^(n-1-j)
+            uint8_t v = 0;
+            for (size_t i = 0; i <= degree; i++)
+            {
+                if (lambda[i])
+                {
+                    v ^= Gf256::Exp(Gf256::Log(lambda[i]) + inv * i);
+                }
+            }
+            if (v == 0)
+            {
+                if (roots == degree)
+                {
+                    return false;
+                }
+                where[roots++] = j;
+            }
+        }
+        if (roots != degree)
+        {
+            return false;
+        }
+
+        uint8_t omega[256] = {0};
+        for (size_t i = 0; i < t2; i++)
+        {
+            for (size_t k = 0; k <= degree && k <= i; k++)
+            {
+                omega[i] ^= Gf256::Mul(syn[i - k], lambda[k]);
+            }
+        }
+        uint8_t value[128];
+        for (size_t e = 0; e < roots; e++)
+        {
+            size_t power = n - 1 - where[e];
+            size_t inv = (255 - power) % 255;
+            uint8_t num = 0;
+            uint8_t den = 0;
+            for (size_t i = 0; i < t2; i++)
+            {
+                if (omega[i])
+                {
+                    num ^= Gf256::Exp(Gf256::Log(omega[i]) + inv * i);
+                }
+            }
+            for (size_t i = 1; i <= degree; i += 2) // formal derivative: only odd powers survive
+            {
+                if (lambda[i])
+                {
+                    den ^= Gf256::Exp(Gf256::Log(lambda[i]) + inv * (i - 1));
+                }
+            }
+            if (den == 0)
+            {
+                return false;
+            }
+            value[e] = Gf256::Mul(Gf256::Exp(power), Gf256::Div(num, den));
+        }
+        for (size_t e = 0; e < roots; e++)
+        {
+            code[where[e] * stride] ^= value[e];
+        }
+        return true;
+    }
+
+  private:
+    /// \p n bytes of scratch from the thread's arena.
+    static uint8_t* Bytes(ArenaScope& scope, size_t n)
+    {
+        return (uint8_t*)scope.Arena().Words((n + 7) / 8);
+    }
+
+    /// Bytes 0..width-1 of rows g..g+rows-1 of a block of rows of \p width bytes, into byte columns.
+    static void Gather(const BitVec& bits, size_t g, size_t rows, size_t width, uint8_t* cols)
+    {
+        for (size_t r = 0; r < rows; r++)
+        {
+            size_t pos = (g + r) * 8 * width;
+            for (size_t j = 0; j < width; j += 8) // eight bytes per read
+            {
+                unsigned k = width - j < 8 ? width - j : 8;
+                uint64_t v = bits.GetBits(pos + 8 * j, 8 * k);
+                for (unsigned b = 0; b < k; b++)
+                {
+                    cols[(j + b) * kGroupRows + r] = (uint8_t)(v >> (8 * (k - 1 - b)));
+                }
+            }
+        }
+    }
+
+    static void Copy(const BitVec& from, size_t in, BitVec& to, size_t out, size_t len)
+    {
+        for (size_t i = 0; i < len; i += 64)
+        {
+            unsigned k = len - i < 64 ? len - i : 64;
+            to.SetBits(out + i, k, from.GetBits(in + i, k));
+        }
+    }
+
+    size_t m_k;                                //!< Data bytes per row.
+    size_t m_parity;                           //!< Parity bytes per row, 2t.
+    GfRegionKernels m_kernels;                 //!< Region multiplies.
+    std::vector<Gf256::MulTable> m_genTables;  //!< Generator coefficients below the leading 1, highest first.
+    std::vector<Gf256::MulTable> m_rootTables; //!< alpha^i, the points the syndromes evaluate at.
+};
+
+#endif /* REED_SOLOMON_H */
@@ -0,0 +1,327 @@
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \brief The assignment's pipeline done the slow way, one character per bit.
+ *
+ * Bits are '0'/'1' strings and every step follows the textbook figures
+ * directly: rows of 8m bits, a Hamming code with the check bits at the
+ * power-of-two positions (1-indexed) each covering the positions that
+ * have that bit set, column-by-column serialization, and CRC as long
+ * division by the generator. No tables, no words, no shortcuts, so that
+ * it can stand as the oracle the fast Codec is compared against.
+ */
+class ReferenceCodec
+{
+  public:
+    /// \param generator CRC generator bit string; leading zeros are ignored.
+    ReferenceCodec(size_t m, const std::string& generator)
+        : m_m(m)
+    {
+        size_t first = generator.find('1');
+        m_generator = first == std::string::npos ? "1" : generator.substr(first);
+        m_checkBits = 0;
+        while ((size_t(1) << m_checkBits) < 8 * m + m_checkBits + 1)
+        {
+            m_checkBits++;
+        }
+    }
+
+    size_t CodeBits() const
+    {
+        return 8 * m_m + m_checkBits;
+    }
+
+    size_t Degree() const
+    {
+        return m_generator.size() - 1;
+    }
+
+    std::string Pad(std::string data) const
+    {
+        while (data.size() % m_m != 0)
+        {
+            data += '~';
+        }
+        return data;
+    }
+
+    /// One row of 8m bits per m characters, most significant bit first.
+    std::vector<std::string> DataBlock(const std::string& padded) const
+    {
+        std::vector<std::string> rows;
+        for (size_t i = 0; i < padded.size(); i += m_m)
+        {
+            std::string row;
+            for (size_t j = i; j < i + m_m; j++)
+            {
+                unsigned char c = padded[j];
+                for (int b = 7; b >= 0; b--)
+                {
+                    row += ((c >> b) & 1) ? '1' : '0';
+                }
+            }
+            rows.push_back(row);
+        }
+        return rows;
+    }
+
+    /// Data bits fill the non-power-of-two positions in order; check bit 2^i makes the parity of its group even.
+    std::string EncodeRow(const std::string& data) const
+    {
+        size_t n = CodeBits();
+        std::string code(n + 1, '0'); // 1-indexed, code[0] unused
+        size_t next = 0;
+        for (size_t pos = 1; pos <= n; pos++)
+        {
+            if (!IsPowerOfTwo(pos))
+            {
+                code[pos] = data[next++];
+            }
+        }
+        for (size_t i = 0; i < m_checkBits; i++)
+        {
+            size_t check = size_t(1) << i;
+            int parity = 0;
+            for (size_t pos = 1; pos <= n; pos++)
+            {
+                if ((pos & check) && pos != check && code[pos] == '1')
+                {
+                    parity ^= 1;
+                }
+            }
+            code[check] = parity ? '1' : '0';
+        }
+        return code.substr(1);
+    }
+
+    /// Read the block column by column, top to bottom.
+    static std::string Serialize(const std::vector<std::string>& rows)
+    {
+        std::string bits;
+        for (size_t c = 0; !rows.empty() && c < rows[0].size(); c++)
+        {
+            for (const std::string& row : rows)
+            {
+                bits += row[c];
+            }
+        }
+        return bits;
+    }
+
+    /// Remainder of bits * x^degree divided by the generator, by long division.
+    std::string Remainder(const std::string& bits) const
+    {
+        std::string work = bits + std::string(Degree(), '0');
+        for (size_t i = 0; i + Degree() < work.size(); i++)
+        {
+            if (work[i] == '1')
+            {
+                for (size_t j = 0; j < m_generator.size(); j++)
+                {
+                    work[i + j] = work[i + j] == m_generator[j] ? '0' : '1';
+                }
+            }
+        }
+        return work.substr(work.size() - Degree());
+    }
+
+    std::string AppendCrc(const std::string& serialized) const
+    {
+        return serialized + Remainder(serialized);
+    }
+
+    /// Divide the whole received frame; it is valid if nothing remains.
+    bool CheckCrc(const std::string& frame) const
+    {
+        std::string work = frame;
+        for (size_t i = 0; i + Degree() < work.size(); i++)
+        {
+            if (work[i] == '1')
+            {
+                for (size_t j = 0; j < m_generator.size(); j++)
+                {
+                    work[i + j] = work[i + j] == m_generator[j] ? '0' : '1';
+                }
+            }
+        }
+        return work.find('1', work.size() - Degree()) == std::string::npos;
+    }
+
+    /// Drop the checksum and refill the block column by column.
+    std::vector<std::string> Deserialize(const std::string& frame) const
+    {
+        size_t n = CodeBits();
+        size_t rows = (frame.size() - Degree()) / n;
+        std::vector<std::string> block(rows, std::string(n, '0'));
+        for (size_t c = 0, i = 0; c < n; c++)
+        {
+            for (size_t r = 0; r < rows; r++, i++)
+            {
+                block[r][c] = frame[i];
+            }
+        }
+        return block;
+    }
+
+    /// Position named by the failed parity checks; 0 if all hold.
+    size_t Syndrome(const std::string& code) const
+    {
+        size_t s = 0;
+        for (size_t i = 0; i < m_checkBits; i++)
+        {
+            size_t check = size_t(1) << i;
+            int parity = 0;
+            for (size_t pos = 1; pos <= code.size(); pos++)
+            {
+                if ((pos & check) && code[pos - 1] == '1')
+                {
+                    parity ^= 1;
+                }
+            }
+            if (parity)
+            {
+                s += check;
+            }
+        }
+        return s;
+    }
+
+    /// Flip the bit the syndrome names, if it names one; true if the syndrome was non-zero.
+    bool CorrectRow(std::string& code) const
+    {
+        size_t s = Syndrome(code);
+        if (s >= 1 && s <= code.size())
+        {
+            code[s - 1] = code[s - 1] == '1' ? '0' : '1';
+        }
+        return s != 0;
+    }
+
+    static std::string StripRow(const std::string& code)
+    {
+        std::string data;
+        for (size_t pos = 1; pos <= code.size(); pos++)
+        {
+            if (!IsPowerOfTwo(pos))
+            {
+                data += code[pos - 1];
+            }
+        }
+        return data;
+    }
+
+    /// Characters of data rows, 8 bits each.
+    static std::string Ascii(const std::vector<std::string>& rows)
+    {
+        std::string out;
+        for (const std::string& row : rows)
+        {
+            for (size_t i = 0; i + 8 <= row.size(); i += 8)
+            {
+                int c = 0;
+                for (size_t b = 0; b < 8; b++)
+                {
+                    c = c * 2 + (row[i + b] - '0');
+                }
+                out += (char)c;
+            }
+        }
+        return out;
+    }
+
+  private:
+    static bool IsPowerOfTwo(size_t x)
+    {
+        return (x & (x - 1)) == 0;
+    }
+
+    size_t m_m;              //!< Characters per row.
+    size_t m_checkBits;      //!< Hamming check bits per row.
+    std::string m_generator; //!< Generator without leading zeros.
+};
+
+/**
+ * \brief Reed-Solomon parity the slow way, for rows given as '0'/'1' strings.
+ *
+ * Field products are shift-and-add modulo 0x11D, without tables; the
+ * generator (x - 1)(x - alpha)...(x - alpha^(2t-1)) is multiplied out
+ * and the parity is the remainder of the long division of data * x^2t
+ * by it. Decoding has no slow counterpart: a decoder is checked by
+ * whether it restores every row with at most t wrong bytes.
+ */
+class ReferenceReedSolomon
+{
+  public:
+    explicit ReferenceReedSolomon(size_t parity)
+        : m_generator(1, 1)
+    {
+        uint8_t root = 1;
+        for (size_t i = 0; i < parity; i++, root = Mul(root, 2))
+        {
+            m_generator.push_back(0);
+            for (size_t j = m_generator.size() - 1; j > 0; j--)
+            {
+                m_generator[j] ^= Mul(m_generator[j - 1], root);
+            }
+        }
+    }
+
+    static uint8_t Mul(uint8_t a, uint8_t b)
+    {
+        unsigned p = 0;
+        unsigned x = a;
+        for (; b; b >>= 1, x <<= 1)
+        {
+            if (x & 0x100)
+            {
+                x ^= 0x11D;
+            }
+            if (b & 1)
+            {
+                p ^= x;
+            }
+        }
+        return (uint8_t)p;
+    }
+
+    /// The row followed by its parity bytes.
+    std::string EncodeRow(const std::string& data) const
+    {
+        std::vector<uint8_t> work;
+        for (size_t i = 0; i + 8 <= data.size(); i += 8)
+        {
+            work.push_back((uint8_t)std::stoi(data.substr(i, 8), nullptr, 2));
+        }
+        size_t k = work.size();
+        size_t parity = m_generator.size() - 1;
+        work.resize(k + parity, 0);
+        for (size_t i = 0; i < k; i++)
+        {
+            uint8_t lead = work[i];
+            for (size_t j = 1; lead && j <= parity; j++)
+            {
+                work[i + j] ^= Mul(m_generator[j], lead);
+            }
+        }
+        std::string code = data;
+        for (size_t i = k; i < k + parity; i++)
+        {
+            for (int b = 7; b >= 0; b--)
+            {
+                code += ((work[i] >> b) & 1) ? '1' : '0';
+            }
+        }
+        return code;
+    }
+
+  private:
+    std::vector<uint8_t> m_generator; //!< Monic generator, highest degree first.
+};
+
+#endif /* REFERENCE_H */
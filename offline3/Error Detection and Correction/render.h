@@ -0,0 +1,206 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "bitblock.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+/**
+ * \brief Builds colored bit dumps in one buffer and writes them with one system call.
+ *
+ * Bits go out as '0'/'1' characters; consecutive bits of the same color
+ * share one escape sequence instead of one per bit, which on a terminal
+ * looks exactly the same. With color off no escape sequences are written
+ * at all. Nothing reaches the file descriptor before Flush, so iostream
+ * output that should come first must be flushed before it.
+ */
+class Renderer
+{
+  public:
+    enum Color
+    {
+        NONE,
+        GREEN,
+        CYAN,
+        RED
+    };
+
+    /// When to color: always, never, or only if the output is a terminal.
+    enum ColorMode
+    {
+        COLOR_AUTO,
+        COLOR_ALWAYS,
+        COLOR_NEVER
+    };
+
+    explicit Renderer(int fd = STDOUT_FILENO, ColorMode mode = COLOR_AUTO)
+        : m_fd(fd),
+          m_color(mode == COLOR_ALWAYS || (mode == COLOR_AUTO && isatty(fd))),
+          m_current(NONE)
+    {
+    }
+
+    ~Renderer()
+    {
+        try
+        {
+            Flush();
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    /// Parse "auto", "always" or "never".
+    static ColorMode ParseMode(const std::string& s)
+    {
+        if (s == "auto")
+        {
+            return COLOR_AUTO;
+        }
+        if (s == "always")
+        {
+            return COLOR_ALWAYS;
+        }
+        if (s == "never")
+        {
+            return COLOR_NEVER;
+        }
+        throw std::invalid_argument("color must be auto, always or never");
+    }
+
+    bool Colored() const
+    {
+        return m_color;
+    }
+
+    Renderer& Text(const std::string& s)
+    {
+        SetColor(NONE);
+        m_buffer += s;
+        return *this;
+    }
+
+    Renderer& Text(const char* s)
+    {
+        SetColor(NONE);
+        m_buffer += s;
+        return *this;
+    }
+
+    /// Text drawn in \p color.
+    Renderer& Text(const std::string& s, Color color)
+    {
+        SetColor(color);
+        m_buffer += s;
+        SetColor(NONE);
+        return *this;
+    }
+
+    /// Bits [pos, pos + n) of \p bits, all in \p color.
+    Renderer& Bits(const BitVec& bits, size_t pos, size_t n, Color color = NONE)
+    {
+        return MaskedBits(bits, pos, n, color, [](size_t, unsigned k) { return k < 64 ? (1ULL << k) - 1 : ~0ULL; });
+    }
+
+    /// Bits [pos, pos + n) of \p bits, those that differ from \p ref in red.
+    Renderer& DiffBits(const BitVec& bits, size_t pos, size_t n, const BitVec& ref)
+    {
+        return MaskedBits(bits, pos, n, RED,
+                          [&](size_t i, unsigned k) { return bits.GetBits(i, k) ^ ref.GetBits(i, k); });
+    }
+
+    /**
+     * \brief Bits [pos, pos + n) of \p bits; \p mask(i, k) returns the k bits from i on to draw in \p color.
+     *
+     * Bits are fetched and masked 64 at a time, both right-aligned like BitVec::GetBits.
+     */
+    template <typename Mask>
+    Renderer& MaskedBits(const BitVec& bits, size_t pos, size_t n, Color color, Mask mask)
+    {
+        for (size_t i = 0; i < n; i += 64)
+        {
+            unsigned k = n - i < 64 ? n - i : 64;
+            uint64_t v = bits.GetBits(pos + i, k);
+            uint64_t m = m_color ? mask(pos + i, k) : 0;
+            if (m == 0)
+            {
+                SetColor(NONE);
+            }
+            for (unsigned j = k; j-- > 0;)
+            {
+                if (m)
+                {
+                    SetColor((m >> j) & 1 ? color : NONE);
+                }
+                m_buffer += (char)('0' + ((v >> j) & 1));
+            }
+        }
+        SetColor(NONE);
+        return *this;
+    }
+
+    /// Everything buffered so far, handed over instead of written; the buffer is emptied.
+    std::string Take()
+    {
+        SetColor(NONE);
+        std::string out;
+        out.swap(m_buffer);
+        return out;
+    }
+
+    /// Write everything buffered so far.
+    void Flush()
+    {
+        SetColor(NONE);
+        size_t done = 0;
+        while (done < m_buffer.size())
+        {
+            ssize_t w = write(m_fd, m_buffer.data() + done, m_buffer.size() - done);
+            if (w < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (w <= 0)
+            {
+                m_buffer.clear();
+                throw std::runtime_error("write failed");
+            }
+            done += w;
+        }
+        m_buffer.clear();
+    }
+
+  private:
+    /// Switch the open color span, emitting only the escapes that change something.
+    void SetColor(Color c)
+    {
+        if (c == m_current || !m_color)
+        {
+            return;
+        }
+        if (m_current != NONE)
+        {
+            m_buffer += "\033[0m";
+        }
+        static const char* const kEscape[] = {"", "\033[32m", "\033[36m", "\033[31m"};
+        m_buffer += kEscape[c];
+        m_current = c;
+    }
+
+    int m_fd;             //!< Output file descriptor.
+    bool m_color;         //!< Emit escape sequences.
+    Color m_current;      //!< Color of the open span.
+    std::string m_buffer; //!< Everything since the last Flush.
+};
+
+#endif /* RENDER_H */
@@ -0,0 +1,154 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+#include <limits>
+
+/**
+ * \brief xoshiro256** generator seeded through SplitMix64.
+ *
+ * Satisfies UniformRandomBitGenerator, so it also works with the
+ * <random> distributions. Equal seeds give equal streams on every
+ * platform, which std::random_device-seeded runs cannot.
+ */
+class Xoshiro256
+{
+  public:
+    typedef uint64_t result_type;
+
+    explicit Xoshiro256(uint64_t seed = 0)
+    {
+        Seed(seed);
+    }
+
+    void Seed(uint64_t seed)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            seed += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            m_s[i] = z ^ (z >> 31);
+        }
+    }
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        uint64_t result = Rotl(m_s[1] * 5, 7) * 9;
+        uint64_t t = m_s[1] << 17;
+        m_s[2] ^= m_s[0];
+        m_s[3] ^= m_s[1];
+        m_s[1] ^= m_s[2];
+        m_s[0] ^= m_s[3];
+        m_s[2] ^= t;
+        m_s[3] = Rotl(m_s[3], 45);
+        return result;
+    }
+
+  private:
+    static uint64_t Rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t m_s[4]; //!< Generator state.
+};
+
+/**
+ * \brief Philox4x32-10 counter-based generator.
+ *
+ * Output block i of a stream is a fixed function of (key, stream, i), so a
+ * Monte-Carlo trial keyed by its own stream id draws the same numbers no
+ * matter which thread runs it or in what order. Each 128-bit block gives
+ * two 64-bit outputs.
+ */
+class Philox4x32
+{
+  public:
+    typedef uint64_t result_type;
+
+    /// \param key run seed. \param stream independent stream id, e.g. (point, trial).
+    Philox4x32(uint64_t key, uint64_t stream)
+        : m_key{(uint32_t)key, (uint32_t)(key >> 32)},
+          m_stream(stream),
+          m_block(0),
+          m_used(2)
+    {
+    }
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        if (m_used == 2)
+        {
+            uint32_t out[4];
+            Block(m_block++, out);
+            m_out[0] = ((uint64_t)out[1] << 32) | out[0];
+            m_out[1] = ((uint64_t)out[3] << 32) | out[2];
+            m_used = 0;
+        }
+        return m_out[m_used++];
+    }
+
+    /// The raw 10-round bijection of counter block \p block of this stream.
+    void Block(uint64_t block, uint32_t out[4]) const
+    {
+        uint32_t c[4] = {(uint32_t)block, (uint32_t)(block >> 32), (uint32_t)m_stream, (uint32_t)(m_stream >> 32)};
+        uint32_t k0 = m_key[0];
+        uint32_t k1 = m_key[1];
+        for (int round = 0; round < 10; round++)
+        {
+            uint64_t p0 = (uint64_t)0xD2511F53U * c[0];
+            uint64_t p1 = (uint64_t)0xCD9E8D57U * c[2];
+            uint32_t n0 = (uint32_t)(p1 >> 32) ^ c[1] ^ k0;
+            uint32_t n2 = (uint32_t)(p0 >> 32) ^ c[3] ^ k1;
+            c[0] = n0;
+            c[1] = (uint32_t)p1;
+            c[2] = n2;
+            c[3] = (uint32_t)p0;
+            k0 += 0x9E3779B9U;
+            k1 += 0xBB67AE85U;
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            out[i] = c[i];
+        }
+    }
+
+  private:
+    uint32_t m_key[2];  //!< Key, the run seed.
+    uint64_t m_stream;  //!< Stream id, the high counter words.
+    uint64_t m_block;   //!< Next block index, the low counter words.
+    uint64_t m_out[2];  //!< Buffered outputs of the current block.
+    int m_used;         //!< Outputs of m_out already returned.
+};
+
+/// Uniform double in (0, 1] from 53 random bits.
+template <typename Rng>
+inline double
+UniformOpen0(Rng& rng)
+{
+    return ((rng() >> 11) + 1) * 0x1p-53;
+}
+
+#endif /* RNG_H */
@@ -0,0 +1,187 @@
+#ifndef SPAN_CODEC_H
+#define SPAN_CODEC_H
+
+#include "arena.h"
+#include "bitblock.h"
+#include "codec.h"
+#include "parallel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if __cplusplus >= 202002L
+#include <span>
+
+template <typename T>
+using Span = std::span<T>;
+#else
+/// The part of std::span the codec API needs, for C++17 builds.
+template <typename T>
+class Span
+{
+  public:
+    Span()
+        : m_data(nullptr),
+          m_size(0)
+    {
+    }
+
+    Span(T* data, size_t size)
+        : m_data(data),
+          m_size(size)
+    {
+    }
+
+    /// Any contiguous container with data() and size(), e.g. a vector or a string.
+    template <typename Container, typename = decltype(std::declval<Container&>().data())>
+    Span(Container& c)
+        : m_data(c.data()),
+          m_size(c.size())
+    {
+    }
+
+    T* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    T& operator[](size_t i) const
+    {
+        return m_data[i];
+    }
+
+    T* begin() const
+    {
+        return m_data;
+    }
+
+    T* end() const
+    {
+        return m_data + m_size;
+    }
+
+    Span subspan(size_t offset, size_t count) const
+    {
+        return Span(m_data + offset, count);
+    }
+
+  private:
+    T* m_data;
+    size_t m_size;
+};
+#endif
+
+/**
+ * \brief Codec front end that works in caller-provided buffers.
+ *
+ * Encode writes the sent frame into the caller's words and Decode writes
+ * the characters into the caller's bytes. The intermediate blocks are
+ * per-thread objects that keep their storage from frame to frame, and the
+ * kernels take their scratch from the thread's FrameArena. Checksums run
+ * in a SerialScope, so a frame above CrcEngine::kParallelGrain is not
+ * split across a new thread pool either. Once a thread has handled its
+ * largest frame, encoding and decoding do not touch the heap, whatever the
+ * frame size. Safe to share between threads.
+ */
+class SpanCodec
+{
+  public:
+    explicit SpanCodec(const Codec& codec)
+        : m_codec(codec)
+    {
+    }
+
+    const Codec& GetCodec() const
+    {
+        return m_codec;
+    }
+
+    /// Bits of the frame for a message of \p len bytes.
+    size_t FrameBits(size_t len) const
+    {
+        return m_codec.FrameBits(len);
+    }
+
+    /// Words Encode needs for a message of \p len bytes.
+    size_t FrameWords(size_t len) const
+    {
+        return BitVec::WordCount(FrameBits(len));
+    }
+
+    /// Bytes Decode writes for a frame of \p nbits bits: the message and its padding.
+    size_t DecodedBytes(size_t nbits) const
+    {
+        return m_codec.FrameRows(nbits) * m_codec.M();
+    }
+
+    /**
+     * \brief Pad, encode, serialize and checksum \p message into \p frame.
+     * \param frame at least FrameWords(message.size()) words.
+     * \return number of frame bits.
+     */
+    size_t Encode(Span<const char> message, Span<uint64_t> frame) const
+    {
+        size_t nbits = FrameBits(message.size());
+        if (frame.size() < BitVec::WordCount(nbits))
+        {
+            throw std::invalid_argument("frame buffer too small");
+        }
+        SerialScope serial;
+        Scratch& s = ThreadScratch();
+        m_codec.DataBlock(message.data(), message.size(), s.data);
+        m_codec.AddCheckBits(s.data, s.code);
+        m_codec.Serialize(s.code, s.frame);
+        m_codec.AppendCrcInPlace(s.frame);
+        std::memcpy(frame.data(), s.frame.Words(), s.frame.NumWords() * sizeof(uint64_t));
+        return nbits;
+    }
+
+    /**
+     * \brief Verify, correct and decode the first \p nbits bits of \p frame into \p out.
+     * \param out at least DecodedBytes(nbits) bytes.
+     */
+    ReceiveResult Decode(Span<const uint64_t> frame, size_t nbits, Span<char> out) const
+    {
+        if (frame.size() < BitVec::WordCount(nbits) || nbits < m_codec.Crc().Degree())
+        {
+            throw std::invalid_argument("frame buffer too small");
+        }
+        if (out.size() < DecodedBytes(nbits))
+        {
+            throw std::invalid_argument("output buffer too small");
+        }
+        SerialScope serial;
+        return m_codec.Receive(frame.data(), nbits, out.data());
+    }
+
+  private:
+    /// Blocks reused by every Encode on one thread.
+    struct Scratch
+    {
+        BitBlock data;
+        BitBlock code;
+        BitVec frame;
+    };
+
+    static Scratch& ThreadScratch()
+    {
+        thread_local Scratch s;
+        return s;
+    }
+
+    const Codec& m_codec;
+};
+
+#endif /* SPAN_CODEC_H */
@@ -0,0 +1,215 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "channel.h"
+#include "codec.h"
+#include "rng.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * \brief Fixed-size chunks of a file or of stdin.
+ *
+ * A regular file is mapped read-only and handed out in place; pages
+ * already passed are released again, so the resident set stays at about
+ * one chunk however large the file is. Anything that cannot be mapped
+ * (a pipe, a terminal) is read into one reusable buffer.
+ */
+class ChunkReader
+{
+  public:
+    /// \param path file to map, or "-" for stdin. \param chunk bytes per chunk.
+    ChunkReader(const std::string& path, size_t chunk)
+        : m_path(path),
+          m_chunk(chunk),
+          m_file(nullptr),
+          m_map(nullptr),
+          m_size(0),
+          m_pos(0),
+          m_released(0)
+    {
+        if (path == "-")
+        {
+            m_file = stdin;
+        }
+        else
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                throw std::runtime_error("cannot open " + path);
+            }
+            struct stat st;
+            if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+            {
+                void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    m_map = (const char*)p;
+                    m_size = st.st_size;
+                    madvise(p, m_size, MADV_SEQUENTIAL);
+                }
+            }
+            if (m_map)
+            {
+                close(fd); // the mapping stays valid
+            }
+            else
+            {
+                m_file = fdopen(fd, "rb");
+                if (!m_file)
+                {
+                    close(fd);
+                    throw std::runtime_error("cannot read " + path);
+                }
+            }
+        }
+        if (!m_map)
+        {
+            m_buffer.resize(m_chunk);
+        }
+    }
+
+    ~ChunkReader()
+    {
+        if (m_map)
+        {
+            munmap((void*)m_map, m_size);
+        }
+        if (m_file && m_file != stdin)
+        {
+            std::fclose(m_file);
+        }
+    }
+
+    ChunkReader(const ChunkReader&) = delete;
+    ChunkReader& operator=(const ChunkReader&) = delete;
+
+    /**
+     * \brief Next chunk; only the last one may be shorter than the chunk size.
+     * \return false at end of input. \p data stays valid until the next call.
+     * Throws std::runtime_error if the input cannot be read.
+     */
+    bool Next(const char*& data, size_t& len)
+    {
+        if (m_map)
+        {
+            size_t page = sysconf(_SC_PAGESIZE);
+            size_t done = m_pos / page * page;
+            if (done > m_released)
+            {
+                madvise((void*)(m_map + m_released), done - m_released, MADV_DONTNEED);
+                m_released = done;
+            }
+            if (m_pos >= m_size)
+            {
+                return false;
+            }
+            data = m_map + m_pos;
+            len = std::min(m_chunk, m_size - m_pos);
+            m_pos += len;
+            return true;
+        }
+        len = 0;
+        while (len < m_chunk)
+        {
+            size_t n = std::fread(&m_buffer[len], 1, m_chunk - len, m_file);
+            if (n == 0)
+            {
+                break;
+            }
+            len += n;
+        }
+        if (std::ferror(m_file))
+        {
+            throw std::runtime_error("cannot read " + m_path);
+        }
+        data = m_buffer.data();
+        return len > 0;
+    }
+
+  private:
+    std::string m_path;   //!< Input path, "-" for stdin.
+    size_t m_chunk;       //!< Bytes per chunk.
+    FILE* m_file;         //!< Unmapped input, or nullptr.
+    const char* m_map;    //!< Mapped file, or nullptr.
+    size_t m_size;        //!< Bytes mapped.
+    size_t m_pos;         //!< Next unread byte of the mapping.
+    size_t m_released;    //!< Bytes of the mapping already given back.
+    std::string m_buffer; //!< Chunk buffer for unmappable input.
+};
+
+struct StreamStats
+{
+    uint64_t chunks = 0;
+    uint64_t bytes = 0;
+    uint64_t bitsFlipped = 0;
+    uint64_t crcRejected = 0;  //!< Chunks whose frame failed the CRC check.
+    uint64_t rowsCorrected = 0;
+    uint64_t badChunks = 0;    //!< Chunks whose output differs from the input.
+    uint64_t sentCrc = 0;      //!< Stream checksum of the input.
+    uint64_t receivedCrc = 0;  //!< Stream checksum of the output.
+};
+
+/**
+ * \brief Send an input through the codec chunk by chunk and write what the receiver decodes.
+ *
+ * Every chunk is one frame of the assignment: padded, Hamming-encoded,
+ * serialized, checksummed, sent through \p channel, verified, corrected
+ * and turned back into bytes, which are written to \p out without the
+ * padding. Besides the per-frame CRC, the checksums of every input and
+ * output chunk are merged with CrcEngine::Combine into checksums of the
+ * whole input and output, so the stream gets an end-to-end check without
+ * being held in memory and without the chunks having to be checksummed
+ * in order.
+ * Chunk k draws its errors from Philox stream k under \p seed. With a
+ * chunk size that is a multiple of m only the last frame is padded.
+ */
+inline StreamStats
+RunStream(ChunkReader& in, const Codec& codec, const Channel& channel, uint64_t seed, FILE* out)
+{
+    StreamStats s;
+    const CrcEngine& crc = codec.Crc();
+    const char* data;
+    size_t len;
+    std::string chunk;
+    std::string decoded;
+    while (in.Next(data, len))
+    {
+        chunk.assign(data, len);
+        BitBlock block = codec.DataBlock(codec.Pad(chunk));
+        BitBlock encoded = codec.AddCheckBits(block);
+        BitVec frame = codec.AppendCrc(codec.Serialize(encoded));
+
+        Philox4x32 rng(seed, s.chunks);
+        s.bitsFlipped += channel.Apply(frame, rng);
+
+        decoded.resize(codec.FrameRows(frame) * codec.M());
+        ReceiveResult rx = codec.Receive(frame, &decoded[0]);
+        s.crcRejected += !rx.crcOk;
+        s.rowsCorrected += rx.rowsCorrected;
+        decoded.resize(len);
+
+        s.sentCrc = crc.Combine(s.sentCrc, crc.Compute((const uint8_t*)data, 8 * len), 8 * len);
+        s.receivedCrc = crc.Combine(s.receivedCrc, crc.Compute((const uint8_t*)decoded.data(), 8 * len), 8 * len);
+        s.badChunks += decoded != chunk;
+        s.chunks++;
+        s.bytes += len;
+        if (out && std::fwrite(decoded.data(), 1, len, out) != len)
+        {
+            throw std::runtime_error("write failed");
+        }
+    }
+    return s;
+}
+
+#endif /* STREAM_H */
@@ -0,0 +1,242 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "channel.h"
+#include "codec.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "rng.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// One (p, m, generator) point of an error-rate sweep.
+struct SweepPoint
+{
+    double p;
+    size_t m;
+    std::string generator;
+};
+
+struct SweepOptions
+{
+    size_t trials = 1000;  //!< Independent frames per point.
+    size_t length = 64;    //!< Characters per random message, before padding.
+    size_t threads = 0;    //!< Worker threads, 0 for all cores.
+    uint64_t seed = 1;     //!< Run seed, the Philox key.
+    size_t chunk = 256;    //!< Trials per work item.
+    Channel channel;       //!< Channel model; every point gets it at its own p.
+    size_t rsParity = 0;   //!< Reed-Solomon parity bytes per row, 0 for Hamming.
+};
+
+/**
+ * \brief Event counts of a batch of trials.
+ *
+ * Only integers are accumulated, so adding the batches of a point up in
+ * any order gives the same totals and the report does not depend on the
+ * number of threads.
+ */
+struct SweepCounts
+{
+    uint64_t trials = 0;
+    uint64_t dataBits = 0;     //!< Padded data bits sent.
+    uint64_t residualBits = 0; //!< Data bits still wrong after correction.
+    uint64_t frameErrors = 0;  //!< Frames with at least one residual bit error.
+    uint64_t framesHit = 0;    //!< Frames the channel touched at all.
+    uint64_t crcDetected = 0;  //!< Touched frames the CRC rejected.
+    uint64_t bitsFlipped = 0;  //!< Bits toggled by the channel, checksum included.
+    uint64_t rowsHit = 0;      //!< Rows that arrived with at least one flipped bit.
+    uint64_t rowsFixed = 0;    //!< Hit rows whose data came out right.
+
+    void Add(const SweepCounts& o)
+    {
+        trials += o.trials;
+        dataBits += o.dataBits;
+        residualBits += o.residualBits;
+        frameErrors += o.frameErrors;
+        framesHit += o.framesHit;
+        crcDetected += o.crcDetected;
+        bitsFlipped += o.bitsFlipped;
+        rowsHit += o.rowsHit;
+        rowsFixed += o.rowsFixed;
+    }
+};
+
+/// Wilson score interval for k successes out of n, z = 1.96 for 95%.
+inline std::pair<double, double>
+WilsonInterval(uint64_t k, uint64_t n, double z = 1.96)
+{
+    if (n == 0)
+    {
+        return {NAN, NAN};
+    }
+    double ph = (double)k / n;
+    double z2 = z * z / n;
+    double centre = (ph + z2 / 2) / (1 + z2);
+    double half = z * std::sqrt(ph * (1 - ph) / n + z2 / (4 * n)) / (1 + z2);
+    return {std::max(0.0, centre - half), std::min(1.0, centre + half)};
+}
+
+/// Stream id of one trial: the point in the top 24 bits, the trial in the low 40.
+inline uint64_t
+TrialStream(size_t point, size_t trial)
+{
+    return ((uint64_t)point << 40) | trial;
+}
+
+/**
+ * \brief Send one random message through the whole pipeline and count what happened.
+ *
+ * With \p metrics every stage is timed into it and the frame's events
+ * are counted there as well.
+ */
+template <typename Rng>
+void
+RunTrial(const Codec& codec, const Channel& channel, size_t length, Rng& rng, SweepCounts& c,
+         CodecMetrics* metrics = nullptr)
+{
+    std::string data(length, '\0');
+    for (size_t i = 0; i < length; i++)
+    {
+        data[i] = (char)rng();
+    }
+    std::string padded = Timed(metrics, STAGE_PAD, 8 * length, [&] { return codec.Pad(data); });
+    BitBlock block = Timed(metrics, STAGE_BLOCK, 8 * padded.size(), [&] { return codec.DataBlock(padded); });
+    BitBlock encoded = Timed(metrics, STAGE_ENCODE, block.Bits().Size(), [&] { return codec.AddCheckBits(block); });
+    BitVec serialized =
+        Timed(metrics, STAGE_SERIALIZE, encoded.Bits().Size(), [&] { return codec.Serialize(encoded); });
+    BitVec frame = Timed(metrics, STAGE_CRC, serialized.Size(), [&] { return codec.AppendCrc(serialized); });
+
+    BitVec received = frame;
+    size_t flips = Timed(metrics, STAGE_CHANNEL, received.Size(), [&] { return channel.Apply(received, rng); });
+    bool crcOk = Timed(metrics, STAGE_VERIFY, received.Size(), [&] { return codec.CheckCrc(received); });
+    BitBlock rxBlock = Timed(metrics, STAGE_DESERIALIZE, received.Size(), [&] { return codec.Deserialize(received); });
+    std::vector<size_t> hit;
+    for (size_t r = 0; r < rxBlock.Rows(); r++)
+    {
+        if (!rxBlock.RowEquals(encoded, r))
+        {
+            hit.push_back(r);
+        }
+    }
+    size_t codeBits = rxBlock.Bits().Size();
+    size_t corrected = Timed(metrics, STAGE_CORRECT, codeBits, [&] { return codec.CorrectRows(rxBlock); });
+    BitBlock out = Timed(metrics, STAGE_DECODE, codeBits, [&] { return codec.RemoveCheckBits(rxBlock); });
+    BitVec diff = out.Bits();
+    diff ^= block.Bits();
+    size_t residual = diff.Count();
+
+    c.trials++;
+    c.dataBits += block.Bits().Size();
+    c.residualBits += residual;
+    c.frameErrors += residual > 0;
+    c.framesHit += flips > 0;
+    c.crcDetected += flips > 0 && !crcOk;
+    c.bitsFlipped += flips;
+    c.rowsHit += hit.size();
+    size_t fixed = 0;
+    for (size_t r : hit)
+    {
+        fixed += out.RowEquals(block, r);
+    }
+    c.rowsFixed += fixed;
+
+    if (metrics)
+    {
+        metrics->frames++;
+        metrics->bitsFlipped += flips;
+        metrics->crcRejects += !crcOk;
+        metrics->rowsCorrected += corrected;
+        metrics->rowsUncorrectable += hit.size() - fixed;
+        metrics->undetected += crcOk && residual > 0;
+    }
+}
+
+/**
+ * \brief Run every point of a sweep on a pool of threads.
+ *
+ * Trials are handed out in chunks from a shared counter. Trial t of point
+ * i always draws from Philox stream TrialStream(i, t) under the run seed,
+ * so the totals are bit-identical for any thread count. With \p metrics
+ * every point also gets its stage times and event counts.
+ */
+inline std::vector<SweepCounts>
+RunSweep(const std::vector<SweepPoint>& points, const SweepOptions& opt, std::vector<CodecMetrics>* metrics = nullptr)
+{
+    std::vector<Codec> codecs;
+    std::vector<Channel> channels;
+    for (const SweepPoint& pt : points)
+    {
+        codecs.emplace_back(pt.m, pt.generator, true, opt.rsParity);
+        channels.push_back(opt.channel.WithP(pt.p));
+    }
+    size_t chunks = (opt.trials + opt.chunk - 1) / opt.chunk;
+    size_t tasks = points.size() * chunks;
+    std::vector<SweepCounts> partial(tasks);
+    std::vector<CodecMetrics> partialMetrics(metrics ? tasks : 0);
+    ParallelFor(tasks, opt.threads, [&](size_t t) {
+        size_t i = t / chunks;
+        size_t first = (t % chunks) * opt.chunk;
+        size_t last = std::min(opt.trials, first + opt.chunk);
+        for (size_t trial = first; trial < last; trial++)
+        {
+            Philox4x32 rng(opt.seed, TrialStream(i, trial));
+            RunTrial(codecs[i], channels[i], opt.length, rng, partial[t], metrics ? &partialMetrics[t] : nullptr);
+        }
+    });
+
+    std::vector<SweepCounts> totals(points.size());
+    for (size_t t = 0; t < tasks; t++)
+    {
+        totals[t / chunks].Add(partial[t]);
+    }
+    if (metrics)
+    {
+        metrics->assign(points.size(), CodecMetrics());
+        for (size_t t = 0; t < tasks; t++)
+        {
+            (*metrics)[t / chunks].Add(partialMetrics[t]);
+        }
+    }
+    return totals;
+}
+
+/**
+ * \brief Print one tab-separated line per point, rates with their 95% Wilson interval.
+ *
+ * Columns: p m generator trials, then rate/low/high for the residual bit
+ * error rate, the frame error rate, the CRC detection rate among frames
+ * the channel touched and the row code's success rate among rows it touched.
+ * The bit error interval treats bits as independent, which they are not
+ * within a frame, so read it as a lower bound on the uncertainty.
+ */
+inline void
+PrintSweep(const std::vector<SweepPoint>& points, const std::vector<SweepCounts>& totals, FILE* out = stdout)
+{
+    std::fprintf(out, "#p\tm\tgenerator\ttrials\tber\tber_lo\tber_hi\tfer\tfer_lo\tfer_hi"
+                      "\tcrc_detect\tcrc_lo\tcrc_hi\tham_fix\tham_lo\tham_hi\n");
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const SweepCounts& c = totals[i];
+        std::pair<uint64_t, uint64_t> rates[4] = {{c.residualBits, c.dataBits},
+                                                   {c.frameErrors, c.trials},
+                                                   {c.crcDetected, c.framesHit},
+                                                   {c.rowsFixed, c.rowsHit}};
+        std::fprintf(out, "%g\t%zu\t%s\t%llu", points[i].p, points[i].m, points[i].generator.c_str(),
+                     (unsigned long long)c.trials);
+        for (auto& r : rates)
+        {
+            std::pair<double, double> ci = WilsonInterval(r.first, r.second);
+            double rate = r.second ? (double)r.first / r.second : NAN;
+            std::fprintf(out, "\t%.6g\t%.6g\t%.6g", rate, ci.first, ci.second);
+        }
+        std::fprintf(out, "\n");
+    }
+}
+
+#endif /* SWEEP_H */
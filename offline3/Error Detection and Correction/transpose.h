@@ -0,0 +1,310 @@
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include "bitblock.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TRANSPOSE_X86 1
+#endif
+
+/**
+ * \brief In-place transpose of a 64x64 bit tile.
+ *
+ * Row i is tile[i], column c is bit 63 - c (MSB first, as in BitVec).
+ * Afterwards tile[c] holds what was column c.
+ */
+typedef void (*Transpose64Fn)(uint64_t* tile);
+
+/// Portable kernel: six rounds of block swaps, 32x32 down to 1x1.
+inline void
+Transpose64Scalar(uint64_t* tile)
+{
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (unsigned j = 32; j != 0; j >>= 1, m ^= m << j)
+    {
+        for (unsigned k = 0; k < 64; k = ((k | j) + 1) & ~j)
+        {
+            uint64_t t = (tile[k] ^ (tile[k | j] >> j)) & m;
+            tile[k] ^= t;
+            tile[k | j] ^= t << j;
+        }
+    }
+}
+
+#ifdef TRANSPOSE_X86
+/**
+ * SSE2 kernel: the same swap network two rows at a time. Rounds 32..2
+ * pair whole registers; round 1 pairs the two halves of one register,
+ * which a 64-bit lane swap brings side by side.
+ */
+__attribute__((target("sse2"))) inline void
+Transpose64Sse2(uint64_t* tile)
+{
+    __m128i v[32];
+    for (int i = 0; i < 32; i++)
+    {
+        v[i] = _mm_loadu_si128((const __m128i*)(tile + 2 * i));
+    }
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (unsigned j = 32; j >= 2; j >>= 1, m ^= m << j)
+    {
+        __m128i mask = _mm_set1_epi64x((long long)m);
+        __m128i shift = _mm_cvtsi32_si128(j);
+        for (unsigned k = 0; k < 64; k = ((k | j) + 2) & ~j)
+        {
+            __m128i a = v[k / 2];
+            __m128i b = v[(k | j) / 2];
+            __m128i t = _mm_and_si128(_mm_xor_si128(a, _mm_srl_epi64(b, shift)), mask);
+            v[k / 2] = _mm_xor_si128(a, t);
+            v[(k | j) / 2] = _mm_xor_si128(b, _mm_sll_epi64(t, shift));
+        }
+    }
+    // round 1, m is now 0x5555...: rows 2i and 2i + 1 share v[i]
+    __m128i mask = _mm_set_epi64x(0, (long long)m);
+    for (int i = 0; i < 32; i++)
+    {
+        __m128i x = v[i];
+        __m128i y = _mm_shuffle_epi32(x, 0x4E);
+        __m128i t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi64(y, 1)), mask);
+        v[i] = _mm_xor_si128(_mm_xor_si128(x, t), _mm_slli_epi64(_mm_shuffle_epi32(t, 0x4E), 1));
+    }
+    for (int i = 0; i < 32; i++)
+    {
+        _mm_storeu_si128((__m128i*)(tile + 2 * i), v[i]);
+    }
+}
+
+/**
+ * AVX2 kernel: four rows per register. Rounds 32..4 pair whole
+ * registers, rounds 2 and 1 pair lanes of one register after a
+ * 128-bit or 64-bit lane swap.
+ */
+__attribute__((target("avx2"))) inline void
+Transpose64Avx2(uint64_t* tile)
+{
+    __m256i v[16];
+    for (int i = 0; i < 16; i++)
+    {
+        v[i] = _mm256_loadu_si256((const __m256i*)(tile + 4 * i));
+    }
+    uint64_t m = 0x00000000FFFFFFFFULL;
+    for (unsigned j = 32; j >= 4; j >>= 1, m ^= m << j)
+    {
+        __m256i mask = _mm256_set1_epi64x((long long)m);
+        __m128i shift = _mm_cvtsi32_si128(j);
+        for (unsigned k = 0; k < 64; k = ((k | j) + 4) & ~j)
+        {
+            __m256i a = v[k / 4];
+            __m256i b = v[(k | j) / 4];
+            __m256i t = _mm256_and_si256(_mm256_xor_si256(a, _mm256_srl_epi64(b, shift)), mask);
+            v[k / 4] = _mm256_xor_si256(a, t);
+            v[(k | j) / 4] = _mm256_xor_si256(b, _mm256_sll_epi64(t, shift));
+        }
+    }
+    // round 2, m is now 0x3333...: rows 4i, 4i + 1 pair with 4i + 2, 4i + 3
+    __m256i mask = _mm256_set_epi64x(0, 0, (long long)m, (long long)m);
+    for (int i = 0; i < 16; i++)
+    {
+        __m256i x = v[i];
+        __m256i y = _mm256_permute4x64_epi64(x, 0x4E);
+        __m256i t = _mm256_and_si256(_mm256_xor_si256(x, _mm256_srli_epi64(y, 2)), mask);
+        v[i] = _mm256_xor_si256(_mm256_xor_si256(x, t), _mm256_slli_epi64(_mm256_permute4x64_epi64(t, 0x4E), 2));
+    }
+    // round 1, m is 0x5555...: rows 2i and 2i + 1 are neighbouring lanes
+    m ^= m << 1;
+    mask = _mm256_set_epi64x(0, (long long)m, 0, (long long)m);
+    for (int i = 0; i < 16; i++)
+    {
+        __m256i x = v[i];
+        __m256i y = _mm256_shuffle_epi32(x, 0x4E);
+        __m256i t = _mm256_and_si256(_mm256_xor_si256(x, _mm256_srli_epi64(y, 1)), mask);
+        v[i] = _mm256_xor_si256(_mm256_xor_si256(x, t), _mm256_slli_epi64(_mm256_shuffle_epi32(t, 0x4E), 1));
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        _mm256_storeu_si256((__m256i*)(tile + 4 * i), v[i]);
+    }
+}
+#endif
+
+/// Name of a kernel, for benchmark output.
+inline const char*
+Transpose64Name(Transpose64Fn fn)
+{
+#ifdef TRANSPOSE_X86
+    if (fn == Transpose64Avx2)
+    {
+        return "avx2";
+    }
+    if (fn == Transpose64Sse2)
+    {
+        return "sse2";
+    }
+#endif
+    return "scalar";
+}
+
+/// True if the running CPU has AVX2.
+inline bool
+CpuHasAvx2()
+{
+#ifdef TRANSPOSE_X86
+    static const bool avx2 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+/// Best kernel the running CPU supports, picked once.
+inline Transpose64Fn
+Transpose64Best()
+{
+    static const Transpose64Fn best = [] {
+#ifdef TRANSPOSE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return (Transpose64Fn)Transpose64Avx2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return (Transpose64Fn)Transpose64Sse2;
+        }
+#endif
+        return (Transpose64Fn)Transpose64Scalar;
+    }();
+    return best;
+}
+
+/**
+ * \brief Transpose a dense row-major rows x cols bit matrix.
+ *
+ * \p out becomes the cols x rows matrix, i.e. the column-major
+ * serialization of \p in. The matrix is walked in 64x64 tiles: each tile
+ * is read with 64 unaligned word loads, transposed in registers and
+ * XORed into the zeroed output with 64 unaligned word stores, so both
+ * directions stream through memory instead of gathering single bits
+ * with a stride of cols.
+ */
+inline void
+TransposeBits(const BitVec& in, size_t rows, size_t cols, BitVec& out, Transpose64Fn kernel = Transpose64Best())
+{
+    out.Resize(rows * cols);
+    std::fill(out.Words(), out.Words() + out.NumWords(), 0);
+    alignas(32) uint64_t tile[64];
+    for (size_t rb = 0; rb < rows; rb += 64)
+    {
+        unsigned nr = rows - rb < 64 ? rows - rb : 64;
+        for (size_t cb = 0; cb < cols; cb += 64)
+        {
+            unsigned nc = cols - cb < 64 ? cols - cb : 64;
+            for (unsigned i = 0; i < nr; i++)
+            {
+                tile[i] = in.GetBits((rb + i) * cols + cb, nc) << (64 - nc);
+            }
+            for (unsigned i = nr; i < 64; i++)
+            {
+                tile[i] = 0;
+            }
+            kernel(tile);
+            for (unsigned c = 0; c < nc; c++)
+            {
+                out.XorBits((cb + c) * rows + rb, nr, tile[c] >> (64 - nr)); // out is zeroed, no read needed
+            }
+        }
+    }
+}
+
+/**
+ * \brief Bit-slice up to 64 consecutive rows of a dense row-major matrix.
+ *
+ * The rows start at bit \p pos of \p bits and are \p cols wide. Column c
+ * lands in slices[c * stride] with row i at bit 63 - i; rows past
+ * \p nrows read as zero.
+ */
+inline void
+LoadSlices(const BitVec& bits, size_t pos, size_t nrows, size_t cols, uint64_t* slices, size_t stride = 1,
+           Transpose64Fn kernel = Transpose64Best())
+{
+    alignas(32) uint64_t tile[64];
+    for (size_t cb = 0; cb < cols; cb += 64)
+    {
+        unsigned nc = cols - cb < 64 ? cols - cb : 64;
+        for (unsigned i = 0; i < nrows; i++)
+        {
+            tile[i] = bits.GetBits(pos + i * cols + cb, nc) << (64 - nc);
+        }
+        for (unsigned i = nrows; i < 64; i++)
+        {
+            tile[i] = 0;
+        }
+        kernel(tile);
+        for (unsigned c = 0; c < nc; c++)
+        {
+            slices[(cb + c) * stride] = tile[c];
+        }
+    }
+}
+
+/// Inverse of LoadSlices: write the first \p nrows rows back to \p bits.
+inline void
+StoreSlices(const uint64_t* slices, size_t stride, size_t nrows, size_t cols, BitVec& bits, size_t pos,
+            Transpose64Fn kernel = Transpose64Best())
+{
+    alignas(32) uint64_t tile[64];
+    for (size_t cb = 0; cb < cols; cb += 64)
+    {
+        unsigned nc = cols - cb < 64 ? cols - cb : 64;
+        for (unsigned c = 0; c < nc; c++)
+        {
+            tile[c] = slices[(cb + c) * stride];
+        }
+        for (unsigned c = nc; c < 64; c++)
+        {
+            tile[c] = 0;
+        }
+        kernel(tile);
+        for (unsigned i = 0; i < nrows; i++)
+        {
+            bits.SetBits(pos + i * cols + cb, nc, tile[i] >> (64 - nc));
+        }
+    }
+}
+
+/// Column-major serialization of a data block.
+inline BitVec
+SerializeColumns(const BitBlock& block)
+{
+    BitVec bits;
+    TransposeBits(block.Bits(), block.Rows(), block.Cols(), bits);
+    return bits;
+}
+
+/// Inverse of SerializeColumns.
+inline BitBlock
+DeserializeColumns(const BitVec& bits, size_t rows, size_t cols)
+{
+    BitVec block;
+    TransposeBits(bits, cols, rows, block);
+    return BitBlock(std::move(block), rows, cols);
+}
+
+/// DeserializeColumns into \p out, reusing its storage; only the first rows * cols bits of \p bits are read.
+inline void
+DeserializeColumns(const BitVec& bits, size_t rows, size_t cols, BitBlock& out)
+{
+    out.Resize(rows, cols); // TransposeBits clears the bits
+    TransposeBits(bits, cols, rows, out.Bits());
+}
+
+#endif /* TRANSPOSE_H */